@@ -0,0 +1,58 @@
+% The rules of all-way-stop_new.cl over the vehicle states the monitor derives natively
+% (bHybridState), instead of over the raw events:
+%   arrived(Vehicle)
+%   waitingAtFork(Vehicle, Fork, ArrivalTime)   arrived and not inside the intersection yet
+%   wantsLane(Vehicle, Lane)                    of waiting vehicles, by their fork and signal
+%   reservedLane(Vehicle, Lane)                 on a lane it wants
+%   leftLane(Vehicle, Lane)                     of vehicles with a reserved lane
+
+%-----------------Traffic--------------
+atTheIntersection(Vehicle):-
+  waitingAtFork(Vehicle, _, _).
+
+arrivedEarlierThan(Vehicle1, Vehicle2):-
+  waitingAtFork(Vehicle1, _, ArrivalTime1),
+  waitingAtFork(Vehicle2, _, ArrivalTime2),
+  ArrivalTime1 < ArrivalTime2.
+
+arrivedSameTime(Vehicle1, Vehicle2):-
+  waitingAtFork(Vehicle1, _, ArrivalTime),
+  waitingAtFork(Vehicle2, _, ArrivalTime).
+
+isToTheRightOf(Vehicle1, Vehicle2):-
+  waitingAtFork(Vehicle1, Fork1, _),
+  waitingAtFork(Vehicle2, Fork2, _),
+  isToTheRightOf(Fork1, Fork2).
+
+%---------------- Rules ---------------
+% Page 35:
+% When there are “STOP” signs at all corners,
+%  yield to the vehicle or bicycle that arrives first.
+mustYieldToForRule(Vehicle2, Vehicle1, firstInFirstOut):-
+  arrivedEarlierThan(Vehicle1, Vehicle2).
+
+% Page 35:
+% When there are “STOP” signs at all corners,
+%  yield to the vehicle or bicycle on your right
+%  if it reaches the intersection at the same time as you.
+mustYieldToForRule(Vehicle1, Vehicle2, yieldToRight):-
+  arrivedSameTime(Vehicle1, Vehicle2),
+  isToTheRightOf(Vehicle2, Vehicle1).
+
+mustYieldToForRule(Vehicle1, Vehicle2, yieldToInside):-
+  atTheIntersection(Vehicle1),
+  wantsLane(Vehicle1, Lane1),
+  overlaps(Lane1, Lane2),
+  reservedLane(Vehicle2, Lane2),
+  not leftLane(Vehicle2, Lane1).
+
+%-------------------------------------------------
+mustYield(Vehicle):-
+  mustYieldToForRule(Vehicle, _, _).
+
+hasRightOfWay(Vehicle):-
+  arrived(Vehicle),
+  not mustYield(Vehicle).
+
+#show mustYieldToForRule/3.
+#show hasRightOfWay/1.
@@ -0,0 +1,276 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+// Out-of-process solver for the TrafficMonitor plugin.
+//
+// Creates the shared memory ring described in SolverServiceProtocol.h, and solves the event batches
+// published by the intersection monitors with clingo, on as many worker threads as requested.
+// Monitors fall back to solving in-process whenever this service is not running.
+//
+// Usage: TrafficSolverService [--workers N]
+// Pin it to cores or a NUMA node with the OS tools, e.g. "start /affinity F0" or "numactl -N 1".
+
+#include "../Source/TrafficMonitor/Public/SolverServiceProtocol.h"
+
+#include <clingo.hh>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <sys/stat.h>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace TrafficSolverService;
+
+namespace
+{
+	std::atomic<bool> bRunning{ true };
+
+	// Rule files and their "<rules file>.config" solver options are read again when modified,
+	// e.g. by TrafficMonitor.ReloadRules or the TrafficSolverTune commandlet
+	struct FRulesFile
+	{
+		time_t ModificationTime;
+		time_t ConfigModificationTime;
+		std::shared_ptr<const std::string> Program;
+		std::shared_ptr<const std::vector<std::string>> Options;
+	};
+	std::mutex RulesLock;
+	std::map<std::string, FRulesFile> Rules;
+
+	time_t GetModificationTime(const std::string& FileName)
+	{
+		struct stat Status;
+		return stat(FileName.c_str(), &Status) == 0 ? Status.st_mtime : 0;
+	}
+
+	bool GetRules(const std::string& RulesFile, FRulesFile& OutRules)
+	{
+		time_t ModificationTime = GetModificationTime(RulesFile);
+		time_t ConfigModificationTime = GetModificationTime(RulesFile + ".config");
+		std::lock_guard<std::mutex> Lock(RulesLock);
+		auto Found = Rules.find(RulesFile);
+		if (Found != Rules.end() && Found->second.ModificationTime == ModificationTime
+			&& Found->second.ConfigModificationTime == ConfigModificationTime)
+		{
+			OutRules = Found->second;
+			return true;
+		}
+		std::ifstream File(RulesFile);
+		if (!File.is_open())
+		{
+			return false;
+		}
+		std::stringstream Buffer;
+		Buffer << File.rdbuf();
+
+		// One option per line, "%" comments
+		auto Options = std::make_shared<std::vector<std::string>>();
+		std::ifstream ConfigFile(RulesFile + ".config");
+		std::string Line;
+		while (std::getline(ConfigFile, Line))
+		{
+			Line.erase(0, Line.find_first_not_of(" \t\r"));
+			Line.erase(Line.find_last_not_of(" \t\r") + 1);
+			if (!Line.empty() && Line[0] != '%')
+			{
+				Options->push_back(Line);
+			}
+		}
+
+		OutRules = FRulesFile{ ModificationTime, ConfigModificationTime, std::make_shared<const std::string>(Buffer.str()), Options };
+		Rules[RulesFile] = OutRules;
+		return true;
+	}
+
+	std::string Solve(const std::string& RulesFile, const std::string& Program)
+	{
+		FRulesFile RulesProgram;
+		if (!GetRules(RulesFile, RulesProgram))
+		{
+			return "error cannot read " + RulesFile + "\n";
+		}
+
+		try {
+			// The last model of the cautious enumeration is the intersection of all answer sets,
+			// and the only model of the stratified rule sets
+			std::vector<char const *> Arguments = { "--enum-mode=cautious", "--models=0" };
+			for (const std::string& Option : *RulesProgram.Options)
+			{
+				Arguments.push_back(Option.c_str());
+			}
+			Clingo::Control ctl{ Clingo::StringSpan{ Arguments.data(), Arguments.size() }, [](Clingo::WarningCode, char const *) {}, 20 };
+			ctl.add("base", {}, Program.c_str());
+			ctl.add("base", {}, RulesProgram.Program->c_str());
+			ctl.ground({ {"base", {}} });
+
+			std::string Decisions;
+			bool bSatisfiable = false;
+			for (auto &model : ctl.solve()) {
+				bSatisfiable = true;
+				Decisions.clear();
+				for (auto &atom : model.symbols(Clingo::ShowType::Shown)) {
+					if (atom.match("mustYieldToForRule", 3))
+					{
+						Decisions += std::string("y ") + atom.arguments()[0].name()
+							+ " " + atom.arguments()[1].name()
+							+ " " + atom.arguments()[2].name() + "\n";
+					}
+					else if (atom.match("hasRightOfWay", 1))
+					{
+						Decisions += std::string("r ") + atom.arguments()[0].name() + "\n";
+					}
+				}
+			}
+			return bSatisfiable ? "ok\n" + Decisions : "unsat\n";
+		}
+		catch (std::exception const &e) {
+			return std::string("error ") + e.what() + "\n";
+		}
+	}
+
+	void Work(FRegion* Region, uint32_t Worker, uint32_t NumWorkers)
+	{
+		while (bRunning)
+		{
+			bool bIdle = true;
+			for (uint32_t i = Worker; i < NumSlots; i += NumWorkers)
+			{
+				FSlot& Slot = Region->Slots[i];
+				uint32_t Expected = Ready;
+				if (!Slot.State.compare_exchange_strong(Expected, Solving))
+				{
+					continue;
+				}
+				bIdle = false;
+
+				std::string Response = Solve(
+					std::string(Slot.RulesFile),
+					std::string(Slot.Program, Slot.ProgramBytes));
+				if (Response.size() > MaxResponseBytes)
+				{
+					Response = "error response too large\n";
+				}
+				std::memcpy(Slot.Response, Response.data(), Response.size());
+				Slot.ResponseBytes = uint32_t(Response.size());
+				Slot.State.store(Done);
+			}
+			if (bIdle)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(200));
+			}
+		}
+	}
+
+	void* CreateRegion()
+	{
+#ifdef _WIN32
+		HANDLE Mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+			DWORD(RegionBytes >> 32), DWORD(RegionBytes & 0xFFFFFFFF), RegionName);
+		if (Mapping == nullptr)
+		{
+			return nullptr;
+		}
+		return MapViewOfFile(Mapping, FILE_MAP_ALL_ACCESS, 0, 0, RegionBytes);
+#else
+		std::string Name = std::string("/") + RegionName;
+		int File = shm_open(Name.c_str(), O_CREAT | O_RDWR, 0600);
+		if (File < 0 || ftruncate(File, RegionBytes) != 0)
+		{
+			return nullptr;
+		}
+		void* Address = mmap(nullptr, RegionBytes, PROT_READ | PROT_WRITE, MAP_SHARED, File, 0);
+		close(File);
+		return Address == MAP_FAILED ? nullptr : Address;
+#endif
+	}
+
+	void DestroyRegion(void* Address)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(Address);
+#else
+		munmap(Address, RegionBytes);
+		shm_unlink((std::string("/") + RegionName).c_str());
+#endif
+	}
+}
+
+
+int main(int argc, char** argv)
+{
+	uint32_t NumWorkers = 1;
+	for (int i = 1; i + 1 < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--workers") == 0)
+		{
+			NumWorkers = uint32_t(std::max(1, std::atoi(argv[i + 1])));
+		}
+	}
+	NumWorkers = std::min(NumWorkers, NumSlots);
+
+	void* Address = CreateRegion();
+	if (Address == nullptr)
+	{
+		std::fprintf(stderr, "Failed to create the shared memory region %s\n", RegionName);
+		return 1;
+	}
+
+	// Slots left over from a previous run are abandoned by the monitors
+	FRegion* Region = new (Address) FRegion;
+	Region->Version = Version;
+	Region->Heartbeat.store(0);
+	for (FSlot& Slot : Region->Slots)
+	{
+		Slot.State.store(Free);
+		Slot.Ticket = 0;
+	}
+	Region->Magic = Magic;
+
+#ifndef _WIN32
+	signal(SIGINT, [](int) { bRunning = false; });
+	signal(SIGTERM, [](int) { bRunning = false; });
+#else
+	SetConsoleCtrlHandler([](DWORD) -> BOOL { bRunning = false; return TRUE; }, TRUE);
+#endif
+
+	std::vector<std::thread> Workers;
+	for (uint32_t Worker = 0; Worker < NumWorkers; Worker++)
+	{
+		Workers.emplace_back(Work, Region, Worker, NumWorkers);
+	}
+	std::printf("Traffic solver service running with %u workers\n", NumWorkers);
+
+	while (bRunning)
+	{
+		Region->Heartbeat.fetch_add(1);
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+
+	for (std::thread& Worker : Workers)
+	{
+		Worker.join();
+	}
+	Region->Magic = 0;
+	DestroyRegion(Address);
+	return 0;
+}
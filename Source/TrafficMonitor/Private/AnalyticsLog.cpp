@@ -0,0 +1,408 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "AnalyticsLog.h"
+#include "HAL/FileManager.h"
+#include "Misc/Compression.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+
+namespace
+{
+	constexpr uint32 AnalyticsMagic = 0x4C414D54; // "TMAL"
+	constexpr uint32 AnalyticsVersion = 2;
+}
+
+
+void FAnalyticsEvents::Append(const FAnalyticsEvents& Other)
+{
+	Time.Append(Other.Time);
+	TimeStep.Append(Other.TimeStep);
+	Predicate.Append(Other.Predicate);
+	Vehicle.Append(Other.Vehicle);
+	Argument1.Append(Other.Argument1);
+	Argument2.Append(Other.Argument2);
+}
+
+
+void FAnalyticsEvents::Empty()
+{
+	*this = FAnalyticsEvents();
+}
+
+
+FArchive& operator<<(FArchive& Ar, FAnalyticsEvents& Events)
+{
+	return Ar << Events.Time << Events.TimeStep << Events.Predicate << Events.Vehicle << Events.Argument1 << Events.Argument2;
+}
+
+
+void FAnalyticsDecisions::Append(const FAnalyticsDecisions& Other)
+{
+	Time.Append(Other.Time);
+	Vehicle.Append(Other.Vehicle);
+	YieldsTo.Append(Other.YieldsTo);
+	Rule.Append(Other.Rule);
+}
+
+
+void FAnalyticsDecisions::Empty()
+{
+	*this = FAnalyticsDecisions();
+}
+
+
+FArchive& operator<<(FArchive& Ar, FAnalyticsDecisions& Decisions)
+{
+	return Ar << Decisions.Time << Decisions.Vehicle << Decisions.YieldsTo << Decisions.Rule;
+}
+
+
+void FAnalyticsSolves::Append(const FAnalyticsSolves& Other)
+{
+	Time.Append(Other.Time);
+	Kind.Append(Other.Kind);
+	NumVehicles.Append(Other.NumVehicles);
+	NumTimeSteps.Append(Other.NumTimeSteps);
+	NumGroundAtoms.Append(Other.NumGroundAtoms);
+	Milliseconds.Append(Other.Milliseconds);
+}
+
+
+void FAnalyticsSolves::Empty()
+{
+	*this = FAnalyticsSolves();
+}
+
+
+FArchive& operator<<(FArchive& Ar, FAnalyticsSolves& Solves)
+{
+	return Ar << Solves.Time << Solves.Kind << Solves.NumVehicles << Solves.NumTimeSteps << Solves.NumGroundAtoms << Solves.Milliseconds;
+}
+
+
+void FAnalyticsTrajectories::Append(const FAnalyticsTrajectories& Other)
+{
+	Vehicle.Append(Other.Vehicle);
+	Lane.Append(Other.Lane);
+	Time.Append(Other.Time);
+	Distance.Append(Other.Distance);
+}
+
+
+void FAnalyticsTrajectories::Empty()
+{
+	*this = FAnalyticsTrajectories();
+}
+
+
+FArchive& operator<<(FArchive& Ar, FAnalyticsTrajectories& Trajectories)
+{
+	return Ar << Trajectories.Vehicle << Trajectories.Lane << Trajectories.Time << Trajectories.Distance;
+}
+
+
+const FString& FAnalyticsTables::GetString(int32 Index) const
+{
+	static const FString None;
+	return Dictionary.IsValidIndex(Index) ? Dictionary[Index] : None;
+}
+
+
+FAnalyticsLog::~FAnalyticsLog()
+{
+	Close();
+}
+
+
+bool FAnalyticsLog::Open(const FString& FileFullName)
+{
+	Close();
+	Writer.Reset(IFileManager::Get().CreateFileWriter(*FileFullName));
+	if (!Writer.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Cannot create the analytics file %s!"), *FileFullName);
+		return false;
+	}
+	uint32 Magic = AnalyticsMagic;
+	uint32 Version = AnalyticsVersion;
+	*Writer << Magic << Version;
+	Dictionary.Empty();
+	NewStrings.Empty();
+	return true;
+}
+
+
+void FAnalyticsLog::AddEvent(double Time, const FMonitorEvent& Event)
+{
+	if (!IsOpen())
+	{
+		return;
+	}
+	Events.Time.Add(Time);
+	Events.TimeStep.Add(Event.TimeStep);
+	Events.Predicate.Add(Encode(Event.Predicate));
+	Events.Vehicle.Add(Event.Arguments.Num() > 0 ? Encode(Event.Arguments[0]) : INDEX_NONE);
+	Events.Argument1.Add(Event.Arguments.Num() > 1 ? Encode(Event.Arguments[1]) : INDEX_NONE);
+	Events.Argument2.Add(Event.Arguments.Num() > 2 ? Encode(Event.Arguments[2]) : INDEX_NONE);
+	if (Events.Num() >= BlockRows)
+	{
+		WriteBlock(EventTable);
+	}
+}
+
+
+void FAnalyticsLog::AddDecisions(double Time, const FDecisionSet& DecisionSet)
+{
+	if (!IsOpen())
+	{
+		return;
+	}
+	for (const FYieldDecision& Decision : DecisionSet.MustYield)
+	{
+		Decisions.Time.Add(Time);
+		Decisions.Vehicle.Add(Encode(Decision.Vehicle));
+		Decisions.YieldsTo.Add(Encode(Decision.YieldsTo));
+		Decisions.Rule.Add(Encode(Decision.Rule));
+	}
+	for (const FString& Vehicle : DecisionSet.RightOfWay)
+	{
+		Decisions.Time.Add(Time);
+		Decisions.Vehicle.Add(Encode(Vehicle));
+		Decisions.YieldsTo.Add(INDEX_NONE);
+		Decisions.Rule.Add(INDEX_NONE);
+	}
+	if (Decisions.Num() >= BlockRows)
+	{
+		WriteBlock(DecisionTable);
+	}
+}
+
+
+void FAnalyticsLog::AddSolve(double Time, EAnalyticsSolve Kind, int32 NumVehicles, int32 NumTimeSteps, int64 NumGroundAtoms, double Seconds)
+{
+	if (!IsOpen())
+	{
+		return;
+	}
+	Solves.Time.Add(Time);
+	Solves.Kind.Add(static_cast<uint8>(Kind));
+	Solves.NumVehicles.Add(NumVehicles);
+	Solves.NumTimeSteps.Add(NumTimeSteps);
+	Solves.NumGroundAtoms.Add(NumGroundAtoms);
+	Solves.Milliseconds.Add(float(1000.0 * Seconds));
+	if (Solves.Num() >= BlockRows)
+	{
+		WriteBlock(SolveTable);
+	}
+}
+
+
+void FAnalyticsLog::AddTrajectory(const FString& Vehicle, const FString& Lane, const FRichCurve& Curve)
+{
+	if (!IsOpen() || Curve.GetNumKeys() == 0)
+	{
+		return;
+	}
+	int32 VehicleIndex = Encode(Vehicle);
+	int32 LaneIndex = Encode(Lane);
+	for (auto KeyIt = Curve.GetKeyIterator(); KeyIt; ++KeyIt)
+	{
+		Trajectories.Vehicle.Add(VehicleIndex);
+		Trajectories.Lane.Add(LaneIndex);
+		Trajectories.Time.Add(KeyIt->Time);
+		Trajectories.Distance.Add(KeyIt->Value);
+	}
+	if (Trajectories.Num() >= BlockRows)
+	{
+		WriteBlock(TrajectoryTable);
+	}
+}
+
+
+void FAnalyticsLog::Flush()
+{
+	if (!IsOpen())
+	{
+		return;
+	}
+	if (Events.Num() > 0)
+	{
+		WriteBlock(EventTable);
+	}
+	if (Decisions.Num() > 0)
+	{
+		WriteBlock(DecisionTable);
+	}
+	if (Solves.Num() > 0)
+	{
+		WriteBlock(SolveTable);
+	}
+	if (Trajectories.Num() > 0)
+	{
+		WriteBlock(TrajectoryTable);
+	}
+	Writer->Flush();
+}
+
+
+void FAnalyticsLog::Close()
+{
+	if (IsOpen())
+	{
+		Flush();
+		Writer->Close();
+		Writer.Reset();
+	}
+}
+
+
+int32 FAnalyticsLog::Encode(const FString& String)
+{
+	if (const int32* Index = Dictionary.Find(String))
+	{
+		return *Index;
+	}
+	int32 Index = Dictionary.Num();
+	Dictionary.Add(String, Index);
+	NewStrings.Add(String);
+	return Index;
+}
+
+
+void FAnalyticsLog::WriteBlock(ETable Table)
+{
+	TArray<uint8> Payload;
+	FMemoryWriter PayloadWriter(Payload);
+	PayloadWriter << NewStrings;
+	int32 NumRows = 0;
+	switch (Table)
+	{
+	case EventTable:
+		NumRows = Events.Num();
+		PayloadWriter << Events;
+		Events.Empty();
+		break;
+	case DecisionTable:
+		NumRows = Decisions.Num();
+		PayloadWriter << Decisions;
+		Decisions.Empty();
+		break;
+	case SolveTable:
+		NumRows = Solves.Num();
+		PayloadWriter << Solves;
+		Solves.Empty();
+		break;
+	case TrajectoryTable:
+		NumRows = Trajectories.Num();
+		PayloadWriter << Trajectories;
+		Trajectories.Empty();
+		break;
+	}
+	NewStrings.Empty();
+
+	int32 UncompressedSize = Payload.Num();
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, UncompressedSize);
+	TArray<uint8> Compressed;
+	Compressed.SetNumUninitialized(CompressedSize);
+	if (!FCompression::CompressMemory(NAME_Zlib, Compressed.GetData(), CompressedSize, Payload.GetData(), UncompressedSize))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to compress an analytics block, closing the file!"));
+		Writer->Close();
+		Writer.Reset();
+		return;
+	}
+
+	uint8 TableId = Table;
+	*Writer << TableId << NumRows << UncompressedSize << CompressedSize;
+	Writer->Serialize(Compressed.GetData(), CompressedSize);
+}
+
+
+bool FAnalyticsLog::Read(const FString& FileFullName, FAnalyticsTables& OutTables)
+{
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*FileFullName));
+	if (!Reader.IsValid())
+	{
+		return false;
+	}
+	OutTables = FAnalyticsTables();
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	*Reader << Magic << Version;
+	if (Magic != AnalyticsMagic || Version < 1 || Version > AnalyticsVersion)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s is not an analytics file of version 1 to %u!"), *FileFullName, AnalyticsVersion);
+		return false;
+	}
+
+	constexpr int64 BlockHeaderBytes = sizeof(uint8) + 3 * sizeof(int32);
+	while (Reader->TotalSize() - Reader->Tell() >= BlockHeaderBytes)
+	{
+		uint8 TableId = 0;
+		int32 NumRows = 0;
+		int32 UncompressedSize = 0;
+		int32 CompressedSize = 0;
+		*Reader << TableId << NumRows << UncompressedSize << CompressedSize;
+		if (CompressedSize < 0 || UncompressedSize < 0 || Reader->TotalSize() - Reader->Tell() < CompressedSize)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s ends with an incomplete block."), *FileFullName);
+			break;
+		}
+		TArray<uint8> Compressed;
+		Compressed.SetNumUninitialized(CompressedSize);
+		Reader->Serialize(Compressed.GetData(), CompressedSize);
+		TArray<uint8> Payload;
+		Payload.SetNumUninitialized(UncompressedSize);
+		if (!FCompression::UncompressMemory(NAME_Zlib, Payload.GetData(), UncompressedSize, Compressed.GetData(), CompressedSize))
+		{
+			UE_LOG(LogTemp, Error, TEXT("%s has a corrupted block."), *FileFullName);
+			return false;
+		}
+
+		FMemoryReader PayloadReader(Payload);
+		TArray<FString> NewStrings;
+		PayloadReader << NewStrings;
+		OutTables.Dictionary.Append(NewStrings);
+		switch (TableId)
+		{
+		case EventTable:
+		{
+			FAnalyticsEvents Block;
+			PayloadReader << Block;
+			OutTables.Events.Append(Block);
+			break;
+		}
+		case DecisionTable:
+		{
+			FAnalyticsDecisions Block;
+			PayloadReader << Block;
+			OutTables.Decisions.Append(Block);
+			break;
+		}
+		case SolveTable:
+		{
+			FAnalyticsSolves Block;
+			PayloadReader << Block;
+			OutTables.Solves.Append(Block);
+			break;
+		}
+		case TrajectoryTable:
+		{
+			FAnalyticsTrajectories Block;
+			PayloadReader << Block;
+			OutTables.Trajectories.Append(Block);
+			break;
+		}
+		default:
+			UE_LOG(LogTemp, Error, TEXT("%s has a block of unknown table %u."), *FileFullName, TableId);
+			return false;
+		}
+		if (PayloadReader.IsError())
+		{
+			UE_LOG(LogTemp, Error, TEXT("%s has a corrupted block."), *FileFullName);
+			return false;
+		}
+	}
+	return true;
+}
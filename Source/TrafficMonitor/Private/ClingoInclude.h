@@ -0,0 +1,13 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Clingo staticly linked library
+THIRD_PARTY_INCLUDES_START
+#pragma push_macro("check")
+#undef check
+#include <clingo.hh>
+#pragma pop_macro("check")
+THIRD_PARTY_INCLUDES_END
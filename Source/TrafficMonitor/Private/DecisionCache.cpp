@@ -0,0 +1,281 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "DecisionCache.h"
+
+
+namespace
+{
+	/// Splits "pred(a, b, c)." into "pred" and {"a", "b", "c"}.
+	void ParseFact(const FString& Fact, FString& OutPredicate, TArray<FString>& OutArguments)
+	{
+		FString Arguments;
+		if (!Fact.Split(TEXT("("), &OutPredicate, &Arguments))
+		{
+			OutPredicate = Fact;
+			OutPredicate.RemoveFromEnd(TEXT("."));
+			return;
+		}
+		Arguments.RemoveFromEnd(TEXT("."));
+		Arguments.RemoveFromEnd(TEXT(")"));
+		Arguments.ParseIntoArray(OutArguments, TEXT(","));
+		for (FString& Argument : OutArguments)
+		{
+			Argument.TrimStartAndEndInline();
+		}
+	}
+
+	FString Rename(const FString& Atom, const TMap<FString, FString>& Renaming)
+	{
+		const FString* Renamed = Renaming.Find(Atom);
+		return Renamed != nullptr ? *Renamed : Atom;
+	}
+
+	FString RenameFact(const FString& Fact, const TMap<FString, FString>& Renaming)
+	{
+		FString Predicate;
+		TArray<FString> Arguments;
+		ParseFact(Fact, Predicate, Arguments);
+		FString Renamed = Predicate + "(";
+		for (int32 i = 0; i < Arguments.Num(); i++)
+		{
+			Renamed += (i > 0 ? TEXT(", ") : TEXT("")) + Rename(Arguments[i], Renaming);
+		}
+		return Renamed + ").";
+	}
+
+	FString CanonicalVehicle(int32 Index)
+	{
+		return "#" + FString::FromInt(Index);
+	}
+}
+
+
+void FDecisionCache::Reset(int32 InCapacity)
+{
+	Capacity = FMath::Max(InCapacity, 1);
+	Entries.Empty(Capacity);
+}
+
+
+void FDecisionCache::SetGeometry(const TArray<FString>& ForksInCyclicOrder, const std::string& Geometry)
+{
+	Symmetries.Empty();
+	Entries.Empty(Capacity);
+
+	TArray<FString> Lines;
+	FString(ANSI_TO_TCHAR(Geometry.c_str())).ParseIntoArrayLines(Lines);
+	TSet<FString> Facts;
+	for (FString& Line : Lines)
+	{
+		Line.TrimStartAndEndInline();
+		if (!Line.IsEmpty())
+		{
+			Facts.Add(RenameFact(Line, {}));
+		}
+	}
+
+	// A lane is identified by its fork and its turn signal, if no two lanes share both
+	TMap<FString, FString> LaneFork;
+	TMap<FString, FString> LaneExit;
+	TMap<FString, FString> LaneSignal;
+	for (const FString& Fact : Facts)
+	{
+		FString Predicate;
+		TArray<FString> Arguments;
+		ParseFact(Fact, Predicate, Arguments);
+		if (Predicate == "laneFromTo" && Arguments.Num() == 3)
+		{
+			LaneFork.Add(Arguments[0], Arguments[1]);
+			LaneExit.Add(Arguments[0], Arguments[2]);
+		}
+		else if (Predicate == "laneCorrectSignal" && Arguments.Num() == 2)
+		{
+			LaneSignal.Add(Arguments[0], Arguments[1]);
+		}
+	}
+	TMap<FString, FString> LaneByForkAndSignal;
+	for (auto& Pair : LaneFork)
+	{
+		FString Key = Pair.Value + "/" + LaneSignal.FindRef(Pair.Key);
+		if (LaneByForkAndSignal.Contains(Key))
+		{
+			return; // Only the identity is known to be safe
+		}
+		LaneByForkAndSignal.Add(Key, Pair.Key);
+	}
+
+	int32 NumForks = ForksInCyclicOrder.Num();
+	for (int32 Rotation = 1; Rotation < NumForks; Rotation++)
+	{
+		TMap<FString, FString> Renaming;
+		for (int32 i = 0; i < NumForks; i++)
+		{
+			Renaming.Add(ForksInCyclicOrder[i], ForksInCyclicOrder[(i + Rotation) % NumForks]);
+		}
+
+		bool bPreservesGeometry = true;
+		for (auto& Pair : LaneFork)
+		{
+			const FString* Image = LaneByForkAndSignal.Find(Renaming[Pair.Value] + "/" + LaneSignal.FindRef(Pair.Key));
+			if (Image == nullptr)
+			{
+				bPreservesGeometry = false;
+				break;
+			}
+			Renaming.Add(Pair.Key, *Image);
+		}
+		for (auto& Pair : LaneExit)
+		{
+			if (!bPreservesGeometry)
+			{
+				break;
+			}
+			const FString& ExitImage = LaneExit[Renaming[Pair.Key]];
+			const FString* PreviousImage = Renaming.Find(Pair.Value);
+			if (PreviousImage != nullptr && *PreviousImage != ExitImage)
+			{
+				bPreservesGeometry = false;
+			}
+			Renaming.Add(Pair.Value, ExitImage);
+		}
+		for (const FString& Fact : Facts)
+		{
+			if (!bPreservesGeometry)
+			{
+				break;
+			}
+			bPreservesGeometry = Facts.Contains(RenameFact(Fact, Renaming));
+		}
+
+		if (bPreservesGeometry)
+		{
+			Symmetries.Add(MoveTemp(Renaming));
+		}
+	}
+}
+
+
+FString FDecisionCache::Canonicalize(const TMap<FString, TArray<FMonitorEvent>>& ActorToEvents, TArray<FString>& OutVehicles) const
+{
+	// Relative times: only the order and the equalities of time steps are kept
+	TArray<int32> TimeSteps;
+	for (auto& Pair : ActorToEvents)
+	{
+		for (const FMonitorEvent& Event : Pair.Value)
+		{
+			TimeSteps.AddUnique(Event.TimeStep);
+		}
+	}
+	TimeSteps.Sort();
+
+	const TMap<FString, FString> Identity;
+	FString BestKey;
+	for (int32 SymmetryIndex = -1; SymmetryIndex < Symmetries.Num(); SymmetryIndex++)
+	{
+		const TMap<FString, FString>& Renaming = SymmetryIndex < 0 ? Identity : Symmetries[SymmetryIndex];
+
+		// Every event is about a single vehicle, so a vehicle is fully described by its own events
+		TArray<TPair<FString, FString>> Signatures; // Signature, vehicle atom
+		for (auto& Pair : ActorToEvents)
+		{
+			if (Pair.Value.Num() == 0)
+			{
+				continue;
+			}
+			TArray<FString> Atoms;
+			for (const FMonitorEvent& Event : Pair.Value)
+			{
+				FString Atom = Event.Predicate + "(V";
+				for (int32 i = 1; i < Event.Arguments.Num(); i++)
+				{
+					Atom += TEXT(",") + Rename(Event.Arguments[i], Renaming);
+				}
+				Atoms.Add(Atom + "," + FString::FromInt(TimeSteps.IndexOfByKey(Event.TimeStep)) + ")");
+			}
+			Atoms.Sort();
+			Signatures.Emplace(FString::Join(Atoms, TEXT(" ")), Pair.Value[0].Arguments[0]);
+		}
+		Signatures.Sort([](const TPair<FString, FString>& A, const TPair<FString, FString>& B) {
+			return A.Key < B.Key;
+		});
+
+		FString Key;
+		for (auto& Signature : Signatures)
+		{
+			Key += Signature.Key + "|";
+		}
+		if (SymmetryIndex < 0 || Key < BestKey)
+		{
+			BestKey = Key;
+			OutVehicles.Empty(Signatures.Num());
+			for (auto& Signature : Signatures)
+			{
+				OutVehicles.Add(Signature.Value);
+			}
+		}
+	}
+	return BestKey;
+}
+
+
+bool FDecisionCache::Find(const FString& Key, const TArray<FString>& Vehicles, FDecisionSet& OutDecisions)
+{
+	const FDecisionSet* Canonical = Entries.FindAndTouch(Key);
+	if (Canonical == nullptr)
+	{
+		return false;
+	}
+
+	// An entry whose canonical indices do not fit the vehicles would name the wrong ones
+	bool bValid = true;
+	auto Vehicle = [&Vehicles, &bValid](const FString& CanonicalName) {
+		int32 Index = FCString::Atoi(*CanonicalName.RightChop(1));
+		if (!CanonicalName.StartsWith(TEXT("#")) || !Vehicles.IsValidIndex(Index))
+		{
+			bValid = false;
+			return FString();
+		}
+		return Vehicles[Index];
+	};
+	OutDecisions = FDecisionSet();
+	for (const FYieldDecision& Decision : Canonical->MustYield)
+	{
+		OutDecisions.MustYield.Add({ Vehicle(Decision.Vehicle), Vehicle(Decision.YieldsTo), Decision.Rule });
+	}
+	for (const FString& RightOfWay : Canonical->RightOfWay)
+	{
+		OutDecisions.RightOfWay.Add(Vehicle(RightOfWay));
+	}
+	if (!bValid)
+	{
+		OutDecisions = FDecisionSet();
+		Entries.Remove(Key);
+		return false;
+	}
+	return true;
+}
+
+
+void FDecisionCache::Add(const FString& Key, const TArray<FString>& Vehicles, const FDecisionSet& Decisions)
+{
+	// Decisions about vehicles without events have no canonical name, so they are not cached
+	bool bValid = true;
+	auto CanonicalName = [&Vehicles, &bValid](const FString& Vehicle) {
+		int32 Index = Vehicles.IndexOfByKey(Vehicle);
+		bValid &= Index != INDEX_NONE;
+		return CanonicalVehicle(Index);
+	};
+	FDecisionSet Canonical;
+	for (const FYieldDecision& Decision : Decisions.MustYield)
+	{
+		Canonical.MustYield.Add({ CanonicalName(Decision.Vehicle), CanonicalName(Decision.YieldsTo), Decision.Rule });
+	}
+	for (const FString& RightOfWay : Decisions.RightOfWay)
+	{
+		Canonical.RightOfWay.Add(CanonicalName(RightOfWay));
+	}
+	if (bValid)
+	{
+		Entries.Add(Key, Canonical);
+	}
+}
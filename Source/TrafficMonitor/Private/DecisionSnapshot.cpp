@@ -0,0 +1,97 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "DecisionSnapshot.h"
+
+
+const FVehicleDecision* FDecisionSnapshot::Find(FName Vehicle) const
+{
+	for (int32 i = 0; i < NumVehicles; i++)
+	{
+		if (Vehicles[i].Vehicle == Vehicle)
+		{
+			return &Vehicles[i];
+		}
+	}
+	return nullptr;
+}
+
+
+void FDecisionSnapshotBuffer::Publish(const FDecisionSet& Decisions, int32 TimeStep)
+{
+	uint32 Index = 1 - Latest.load(std::memory_order_relaxed);
+	FBuffer& Buffer = Buffers[Index];
+
+	Buffer.Sequence.fetch_add(1, std::memory_order_relaxed); // Odd: being written
+	std::atomic_thread_fence(std::memory_order_release);
+
+	FDecisionSnapshot& Snapshot = Buffer.Snapshot;
+	Snapshot.Version = LatestVersion.load(std::memory_order_relaxed) + 1;
+	Snapshot.TimeStep = TimeStep;
+	Snapshot.NumVehicles = 0;
+	TSet<FName> DroppedVehicles;
+	auto AddVehicle = [&Snapshot, &DroppedVehicles](const FString& VehicleAtom) -> FVehicleDecision* {
+		FName Vehicle(*VehicleAtom.RightChop(2));
+		if (Snapshot.Find(Vehicle) != nullptr)
+		{
+			return nullptr;
+		}
+		if (Snapshot.NumVehicles == FDecisionSnapshot::MaxVehicles)
+		{
+			DroppedVehicles.Add(Vehicle);
+			return nullptr;
+		}
+		FVehicleDecision& Decision = Snapshot.Vehicles[Snapshot.NumVehicles++];
+		Decision.Vehicle = Vehicle;
+		return &Decision;
+	};
+	for (const FString& RightOfWay : Decisions.RightOfWay)
+	{
+		if (FVehicleDecision* Decision = AddVehicle(RightOfWay))
+		{
+			Decision->bHasRightOfWay = true;
+			Decision->YieldsTo = NAME_None;
+			Decision->Rule = NAME_None;
+		}
+	}
+	for (const FYieldDecision& Yield : Decisions.MustYield)
+	{
+		if (FVehicleDecision* Decision = AddVehicle(Yield.Vehicle))
+		{
+			Decision->bHasRightOfWay = false;
+			Decision->YieldsTo = FName(*Yield.YieldsTo.RightChop(2));
+			Decision->Rule = FName(*Yield.Rule);
+		}
+	}
+
+	Snapshot.NumDroppedVehicles = DroppedVehicles.Num();
+	if (!Snapshot.IsComplete() && Buffers[1 - Index].Snapshot.IsComplete())
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Decision snapshot lacks %d of %d vehicles, it holds at most %d."),
+			Snapshot.NumDroppedVehicles, Snapshot.NumVehicles + Snapshot.NumDroppedVehicles, FDecisionSnapshot::MaxVehicles);
+	}
+
+	Buffer.Sequence.fetch_add(1, std::memory_order_release); // Even: complete
+	Latest.store(Index, std::memory_order_release);
+	LatestVersion.store(Snapshot.Version, std::memory_order_release);
+}
+
+
+FDecisionSnapshot FDecisionSnapshotBuffer::Read() const
+{
+	FDecisionSnapshot Snapshot;
+	for (;;)
+	{
+		const FBuffer& Buffer = Buffers[Latest.load(std::memory_order_acquire)];
+		uint32 Before = Buffer.Sequence.load(std::memory_order_acquire);
+		if (Before % 2 == 1)
+		{
+			continue; // The writer lapped us and is rewriting it
+		}
+		FMemory::Memcpy(&Snapshot, &Buffer.Snapshot, sizeof(FDecisionSnapshot));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (Buffer.Sequence.load(std::memory_order_relaxed) == Before)
+		{
+			return Snapshot;
+		}
+	}
+}
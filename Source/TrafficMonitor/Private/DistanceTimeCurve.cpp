@@ -45,3 +45,53 @@ float UDistanceTimeCurve::Eval(float InTime)
 	return RichCurve.Eval(InTime);
 }
 
+
+void UDistanceTimeCurve::AddSample(float InTime, float InDistance, float Tolerance)
+{
+	if (RichCurve.GetNumKeys() == 0)
+	{
+		AddLinearKey(InTime, InDistance);
+		MinSlope = -BIG_NUMBER;
+		MaxSlope = BIG_NUMBER;
+		return;
+	}
+	const FRichCurveKey& LastKey = RichCurve.GetLastKey();
+	if (InTime <= LastKey.Time || (bHasPendingSample && InTime <= PendingTime))
+	{
+		return;
+	}
+
+	float Slope = (InDistance - LastKey.Value) / (InTime - LastKey.Time);
+	if (Slope < MinSlope || Slope > MaxSlope)
+	{
+		// No line from the last key fits all samples anymore: keep the previous sample and swing from it
+		AddLinearKey(PendingTime, PendingDistance);
+		MinSlope = -BIG_NUMBER;
+		MaxSlope = BIG_NUMBER;
+	}
+	const FRichCurveKey& Anchor = RichCurve.GetLastKey();
+	MinSlope = FMath::Max(MinSlope, (InDistance - Tolerance - Anchor.Value) / (InTime - Anchor.Time));
+	MaxSlope = FMath::Min(MaxSlope, (InDistance + Tolerance - Anchor.Value) / (InTime - Anchor.Time));
+	bHasPendingSample = true;
+	PendingTime = InTime;
+	PendingDistance = InDistance;
+}
+
+
+void UDistanceTimeCurve::FinishSamples()
+{
+	if (bHasPendingSample)
+	{
+		AddLinearKey(PendingTime, PendingDistance);
+		bHasPendingSample = false;
+	}
+	MinSlope = -BIG_NUMBER;
+	MaxSlope = BIG_NUMBER;
+}
+
+
+void UDistanceTimeCurve::AddLinearKey(float InTime, float InDistance)
+{
+	FKeyHandle KeyHandle = RichCurve.AddKey(InTime, InDistance);
+	RichCurve.SetKeyInterpMode(KeyHandle, ERichCurveInterpMode::RCIM_Linear);
+}
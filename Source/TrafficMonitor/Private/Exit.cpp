@@ -3,6 +3,9 @@
 
 #include "Exit.h"
 
+// Developer
+#include "TriggerCollision.h"
+
 // Sets default values
 AExit::AExit(const FObjectInitializer &ObjectInitializer)
 	: Super(ObjectInitializer)
@@ -15,8 +18,7 @@ AExit::AExit(const FObjectInitializer &ObjectInitializer)
 	TriggerVolume->SetupAttachment(RootComponent);
 	TriggerVolume->SetHiddenInGame(false);
 	TriggerVolume->SetMobility(EComponentMobility::Static);
-	TriggerVolume->SetCollisionProfileName(FName("OverlapAll"));
-	TriggerVolume->SetGenerateOverlapEvents(true);
+	TriggerCollision::SetupTrigger(TriggerVolume);
 	TriggerVolume->SetBoxExtent(FVector{ 20.0f, 150.f, 50.0f });
 	TriggerVolume->ShapeColor = FColor(255, 0, 0);
 
@@ -32,8 +34,18 @@ void AExit::BeginPlay()
 {
 	Super::BeginPlay();
 
-	TriggerVolume->SetCollisionProfileName(FName("OverlapAll"));
-	TriggerVolume->SetGenerateOverlapEvents(true);	
+	TriggerCollision::SetupTrigger(TriggerVolume);
 }
 
 
+#if WITH_EDITOR
+void AExit::PostEditMove(bool bFinished)
+{
+	Super::PostEditMove(bFinished);
+
+	if (bFinished)
+	{
+		AIntersectionMonitor::NotifyGeometryChanged(this);
+	}
+}
+#endif // WITH_EDITOR
@@ -6,6 +6,9 @@
 
 #include "Engine/CollisionProfile.h"
 
+// Developer
+#include "TriggerCollision.h"
+
 // Sets default values
 AFork::AFork(const FObjectInitializer &ObjectInitializer)
 	: Super(ObjectInitializer)
@@ -18,8 +21,7 @@ AFork::AFork(const FObjectInitializer &ObjectInitializer)
 	EntranceTriggerVolume->SetupAttachment(RootComponent);
 	EntranceTriggerVolume->SetHiddenInGame(false);
 	EntranceTriggerVolume->SetMobility(EComponentMobility::Static);
-	EntranceTriggerVolume->SetCollisionProfileName(FName("OverlapAll"));
-	EntranceTriggerVolume->SetGenerateOverlapEvents(true);
+	TriggerCollision::SetupTrigger(EntranceTriggerVolume);
 	EntranceTriggerVolume->SetBoxExtent(FVector{ 50.0f, 150.0f, 50.0f });
 	EntranceTriggerVolume->ShapeColor = FColor(0, 255, 0);
 	EntranceTriggerVolume->SetRelativeLocation(FVector(50.f, 0.f, 0.f));
@@ -28,8 +30,7 @@ AFork::AFork(const FObjectInitializer &ObjectInitializer)
 	ArrivalTriggerVolume->SetupAttachment(RootComponent);
 	ArrivalTriggerVolume->SetHiddenInGame(false);
 	ArrivalTriggerVolume->SetMobility(EComponentMobility::Static);
-	ArrivalTriggerVolume->SetCollisionProfileName(FName("OverlapAll"));
-	ArrivalTriggerVolume->SetGenerateOverlapEvents(true);
+	TriggerCollision::SetupTrigger(ArrivalTriggerVolume);
 	ArrivalTriggerVolume->ShapeColor = FColor(0, 0, 255);
 	ArrivalTriggerVolume->SetBoxExtent(FVector{ 200.0f, 150.0f, 50.0f });
 	ArrivalTriggerVolume->SetRelativeLocation(FVector(-200.f, 0.f, 0.f));
@@ -47,11 +48,9 @@ void AFork::BeginPlay()
 {
 	Super::BeginPlay();
 
-	ArrivalTriggerVolume->SetCollisionProfileName(FName("OverlapAll"));
-	ArrivalTriggerVolume->SetGenerateOverlapEvents(true);
+	TriggerCollision::SetupTrigger(ArrivalTriggerVolume);
 
-	EntranceTriggerVolume->SetCollisionProfileName(FName("OverlapAll"));
-	EntranceTriggerVolume->SetGenerateOverlapEvents(true);
+	TriggerCollision::SetupTrigger(EntranceTriggerVolume);
 }
 
 
@@ -66,6 +65,13 @@ void AFork::PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent)
 		return;
 	}
 	
+	ALane::BuildLanes(UpdateLanes());
+}
+
+
+TArray<ALane*> AFork::UpdateLanes()
+{
+	TArray<ALane*> NewLanes;
 	for (FExitCheckbox& ExitCheckbox : Exits)
 	{
 		if (ExitCheckbox.bActive && ExitCheckbox.Lane == nullptr)
@@ -76,6 +82,7 @@ void AFork::PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent)
 			ExitCheckbox.Lane = GetWorld()->SpawnActor<ALane>(spawnParams);
 			ExitCheckbox.Lane->SetActorLabel(LaneName);
 			ExitCheckbox.Lane->Init(this, ExitCheckbox.Exit);
+			NewLanes.Add(ExitCheckbox.Lane);
 		}
 		else if (!ExitCheckbox.bActive && ExitCheckbox.Lane != nullptr)
 		{
@@ -83,6 +90,7 @@ void AFork::PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent)
 			ExitCheckbox.Lane = nullptr;
 		}
 	}
+	return NewLanes;
 }
 #endif // WITH_EDITOR
 
@@ -93,23 +101,29 @@ void AFork::PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent)
 //	UE_LOG(LogTemp, Warning, TEXT("AFork OnConstruction called!"));
 //}
 
-//void AFork::PostEditMove(bool bFinished)
-//{
-//	Super::PostEditMove(bFinished);
-//
-//	if (bFinished)
-//	{
-//		UE_LOG(LogTemp, Warning, TEXT("AFork PostEditMove called!"));
-//		ConnectToMonitor();
-//	}
-//}
+#if WITH_EDITOR
+void AFork::PostEditMove(bool bFinished)
+{
+	Super::PostEditMove(bFinished);
+
+	if (bFinished)
+	{
+		AIntersectionMonitor::NotifyGeometryChanged(this);
+	}
+}
+#endif // WITH_EDITOR
 
 
 /// Formalization of "isToTheRightOf()" based on approaching angles of forks
 bool AFork::IsToTheRightOf(const AFork* OtherFork) const
 {
-	auto Ego = FVector2D(GetActorForwardVector());
-	auto Other = FVector2D(OtherFork->GetActorForwardVector());
+	return IsToTheRightOf(GetActorForwardVector(), OtherFork->GetActorForwardVector());
+}
+
+bool AFork::IsToTheRightOf(const FVector& Direction, const FVector& OtherDirection)
+{
+	auto Ego = FVector2D(Direction);
+	auto Other = FVector2D(OtherDirection);
 	float Sine = FVector2D::CrossProduct(Ego, Other); // Ego and Other are unit vectors
 	if (Sine > 0.5f) // angle in (30, 150) degrees
 	{
@@ -0,0 +1,111 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "GeometryFacts.h"
+
+
+void FGeometryFacts::Reset()
+{
+	FactsByAtom.Empty();
+	FactsByPair.Empty();
+	PairedAtoms.Empty();
+	bProgramIsStale = true;
+}
+
+
+void FGeometryFacts::SetFacts(const FString& Atom, const TArray<FString>& Facts)
+{
+	FactsByAtom.Add(Atom, Facts);
+	bProgramIsStale = true;
+}
+
+
+void FGeometryFacts::SetPairFacts(const FString& AtomA, const FString& AtomB, const TArray<FString>& Facts)
+{
+	TPair<FString, FString> Key = MakePairKey(AtomA, AtomB);
+	if (Facts.Num() > 0)
+	{
+		FactsByPair.Add(Key, Facts);
+		PairedAtoms.FindOrAdd(AtomA).Add(AtomB);
+		PairedAtoms.FindOrAdd(AtomB).Add(AtomA);
+	}
+	else if (FactsByPair.Remove(Key) > 0)
+	{
+		PairedAtoms.FindOrAdd(AtomA).Remove(AtomB);
+		PairedAtoms.FindOrAdd(AtomB).Remove(AtomA);
+	}
+	else
+	{
+		return;
+	}
+	bProgramIsStale = true;
+}
+
+
+void FGeometryFacts::Remove(const FString& Atom)
+{
+	FactsByAtom.Remove(Atom);
+	TSet<FString> Paired;
+	if (PairedAtoms.RemoveAndCopyValue(Atom, Paired))
+	{
+		for (const FString& Other : Paired)
+		{
+			FactsByPair.Remove(MakePairKey(Atom, Other));
+			if (TSet<FString>* OtherPaired = PairedAtoms.Find(Other))
+			{
+				OtherPaired->Remove(Atom);
+			}
+		}
+	}
+	bProgramIsStale = true;
+}
+
+
+int32 FGeometryFacts::Num() const
+{
+	int32 NumFacts = 0;
+	for (auto& Pair : FactsByAtom)
+	{
+		NumFacts += Pair.Value.Num();
+	}
+	for (auto& Pair : FactsByPair)
+	{
+		NumFacts += Pair.Value.Num();
+	}
+	return NumFacts;
+}
+
+
+const std::string& FGeometryFacts::GetProgram() const
+{
+	if (!bProgramIsStale)
+	{
+		return Program;
+	}
+
+	// Sorted, so that equal geometries give equal programs, e.g. for the decision cache and checkpoints
+	TArray<FString> Facts;
+	for (auto& Pair : FactsByAtom)
+	{
+		Facts.Append(Pair.Value);
+	}
+	for (auto& Pair : FactsByPair)
+	{
+		Facts.Append(Pair.Value);
+	}
+	Facts.Sort();
+
+	Program.clear();
+	for (const FString& Fact : Facts)
+	{
+		Program += TCHAR_TO_ANSI(*Fact);
+		Program += "\n";
+	}
+	bProgramIsStale = false;
+	return Program;
+}
+
+
+TPair<FString, FString> FGeometryFacts::MakePairKey(const FString& AtomA, const FString& AtomB)
+{
+	return AtomA < AtomB ? TPair<FString, FString>(AtomA, AtomB) : TPair<FString, FString>(AtomB, AtomA);
+}
@@ -0,0 +1,27 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "IntersectionGenerator.h"
+
+// Developer
+#include "IntersectionMonitor.h"
+
+
+AIntersectionGenerator::AIntersectionGenerator(const FObjectInitializer &ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	RootComponent =
+		ObjectInitializer.CreateDefaultSubobject<USceneComponent>(this, TEXT("SceneRootComponent"));
+	RootComponent->SetMobility(EComponentMobility::Static);
+}
+
+
+#if WITH_EDITOR
+void AIntersectionGenerator::Generate()
+{
+	FRandomStream Random(Seed);
+	FIntersectionLayout Layout = FIntersectionLayout::Generate(Settings, Random);
+	GeneratedMonitor = Layout.Spawn(GetWorld(), GetActorTransform());
+	UE_LOG(LogTemp, Log, TEXT("%s generated %d forks, %d exits and %d lanes under %s."),
+		*GetName(), Layout.Forks.Num(), Layout.Exits.Num(), Layout.Lanes.Num(), *GeneratedMonitor->GetName());
+}
+#endif // WITH_EDITOR
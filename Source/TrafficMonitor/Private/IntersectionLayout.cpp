@@ -0,0 +1,278 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "IntersectionLayout.h"
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+
+// Developer
+#include "Exit.h"
+#include "Fork.h"
+#include "IntersectionMonitor.h"
+
+
+namespace
+{
+	template <class ActorClass>
+	ActorClass* SpawnNamed(UWorld* World, const FString& Name, const FTransform& Transform)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Name = MakeUniqueObjectName(World->GetCurrentLevel(), ActorClass::StaticClass(), FName(*Name));
+		ActorClass* Actor = World->SpawnActor<ActorClass>(ActorClass::StaticClass(), Transform, SpawnParams);
+#if WITH_EDITOR
+		Actor->SetActorLabel(Name);
+#endif // WITH_EDITOR
+		return Actor;
+	}
+}
+
+
+FIntersectionLayout FIntersectionLayout::Generate(const FIntersectionLayoutSettings& Settings, FRandomStream& Random)
+{
+	FIntersectionLayout Layout;
+	Layout.LaneWidth = Settings.LaneWidth;
+	Layout.MaxMeshLength = Settings.MaxMeshLength;
+
+	TArray<float> Angles = Settings.ApproachAngles;
+	if (Angles.Num() == 0)
+	{
+		int32 NumApproaches = FMath::Max(Settings.NumApproaches, 2);
+		float Spacing = 360.f / NumApproaches;
+		float Jitter = FMath::Clamp(Settings.AngleJitter, 0.f, Spacing / 4.f);
+		for (int32 i = 0; i < NumApproaches; i++)
+		{
+			Angles.Add(i * Spacing + Random.FRandRange(-Jitter, Jitter));
+		}
+	}
+	Angles.Sort();
+
+	// Far enough from the center for neighboring approaches, LanesPerApproach lanes each way, to be apart
+	float MinSpacing = 360.f;
+	for (int32 i = 0; i < Angles.Num(); i++)
+	{
+		float Next = i + 1 < Angles.Num() ? Angles[i + 1] : Angles[0] + 360.f;
+		MinSpacing = FMath::Min(MinSpacing, Next - Angles[i]);
+	}
+	MinSpacing = FMath::Clamp(MinSpacing, 5.f, 179.f);
+	float ApproachHalfWidth = Settings.LanesPerApproach * Settings.LaneWidth;
+	Layout.Radius = FMath::Max(Settings.MinRadius, 1.25f * ApproachHalfWidth / FMath::Tan(FMath::DegreesToRadians(MinSpacing) / 2.f));
+
+	// Right-hand traffic: forks on the right of the inbound heading, exits on the right of the outbound one
+	for (int32 Approach = 0; Approach < Angles.Num(); Approach++)
+	{
+		float Angle = FMath::DegreesToRadians(Angles[Approach]);
+		FVector Outwards(FMath::Cos(Angle), FMath::Sin(Angle), 0.f);
+		FVector InboundRight(Outwards.Y, -Outwards.X, 0.f);
+		for (int32 LaneIndex = 0; LaneIndex < Settings.LanesPerApproach; LaneIndex++)
+		{
+			float Offset = (LaneIndex + 0.5f) * Settings.LaneWidth;
+			Layout.Forks.Add({ FString::Printf(TEXT("Fork_%d_%d"), Approach, LaneIndex),
+				Outwards * Layout.Radius + InboundRight * Offset, -Outwards, Approach, LaneIndex });
+			Layout.Exits.Add({ FString::Printf(TEXT("Exit_%d_%d"), Approach, LaneIndex),
+				Outwards * Layout.Radius - InboundRight * Offset, Outwards, Approach, LaneIndex });
+		}
+	}
+
+	for (int32 Fork = 0; Fork < Layout.Forks.Num(); Fork++)
+	{
+		for (int32 Exit = 0; Exit < Layout.Exits.Num(); Exit++)
+		{
+			const FLayoutEndpoint& From = Layout.Forks[Fork];
+			const FLayoutEndpoint& To = Layout.Exits[Exit];
+			if ((From.Approach == To.Approach && !Settings.bUTurns) || (From.LaneIndex != To.LaneIndex && !Settings.bAllExitLanes))
+			{
+				continue;
+			}
+			Layout.Lanes.Add({ From.Name + "_to_" + To.Name, Fork, Exit });
+		}
+	}
+	return Layout;
+}
+
+
+TArray<FLaneEndpoints> FIntersectionLayout::GetLaneEndpoints() const
+{
+	TArray<FLaneEndpoints> Endpoints;
+	for (const FLayoutLane& Lane : Lanes)
+	{
+		FLaneEndpoints LaneEndpoints;
+		LaneEndpoints.LaneTransform = FTransform::Identity;
+		LaneEndpoints.EntranceLocation = Forks[Lane.Fork].Location;
+		LaneEndpoints.EntranceDirection = Forks[Lane.Fork].Direction;
+		LaneEndpoints.EntranceWidth = LaneWidth / 2.f;
+		LaneEndpoints.ExitLocation = Exits[Lane.Exit].Location;
+		LaneEndpoints.ExitDirection = Exits[Lane.Exit].Direction;
+		LaneEndpoints.ExitWidth = LaneWidth / 2.f;
+		LaneEndpoints.MaxMeshLength = MaxMeshLength;
+		Endpoints.Add(LaneEndpoints);
+	}
+	return Endpoints;
+}
+
+
+void FIntersectionLayout::ExtractGeometryFacts(const TArray<FLaneGeometry>& LaneGeometries, FGeometryFacts& OutFacts, FLaneConflictMatrix& OutConflicts) const
+{
+	OutFacts.Reset();
+	OutConflicts.Reset();
+
+	for (int32 i = 0; i < Forks.Num(); i++)
+	{
+		for (int32 j = i + 1; j < Forks.Num(); j++)
+		{
+			FString ForkAtom = "f_" + Forks[i].Name;
+			FString OtherAtom = "f_" + Forks[j].Name;
+			if (AFork::IsToTheRightOf(Forks[i].Direction, Forks[j].Direction))
+			{
+				OutFacts.SetPairFacts(ForkAtom, OtherAtom, { "isToTheRightOf(" + ForkAtom + ", " + OtherAtom + ")." });
+			}
+			else if (AFork::IsToTheRightOf(Forks[j].Direction, Forks[i].Direction))
+			{
+				OutFacts.SetPairFacts(ForkAtom, OtherAtom, { "isToTheRightOf(" + OtherAtom + ", " + ForkAtom + ")." });
+			}
+		}
+	}
+
+	TArray<int32> LaneIndices;
+	for (const FLayoutLane& Lane : Lanes)
+	{
+		FString LaneAtom = "l_" + Lane.Name;
+		LaneIndices.Add(OutConflicts.AddLane(LaneAtom));
+		FString Signal = ALane::GetCorrectSignal(Forks[Lane.Fork].Direction, Exits[Lane.Exit].Direction);
+		OutFacts.SetFacts(LaneAtom, {
+			"laneFromTo(" + LaneAtom + ", f_" + Forks[Lane.Fork].Name + ", e_" + Exits[Lane.Exit].Name + ").",
+			"laneCorrectSignal(" + LaneAtom + ", " + Signal + ").",
+			"overlaps(" + LaneAtom + ", " + LaneAtom + ")."
+		});
+	}
+
+	// The pairwise tests dominate, so each lane tests the later ones on its own thread
+	TArray<TArray<int32>> LaterOverlaps;
+	LaterOverlaps.SetNum(Lanes.Num());
+	ParallelFor(Lanes.Num(), [this, &LaneGeometries, &LaterOverlaps](int32 i) {
+		for (int32 j = i + 1; j < Lanes.Num(); j++)
+		{
+			if (SegmentsOverlap(LaneGeometries[i], LaneGeometries[j]))
+			{
+				LaterOverlaps[i].Add(j);
+			}
+		}
+	});
+	for (int32 i = 0; i < Lanes.Num(); i++)
+	{
+		FString LaneAtom = "l_" + Lanes[i].Name;
+		for (int32 j : LaterOverlaps[i])
+		{
+			FString OtherAtom = "l_" + Lanes[j].Name;
+			OutFacts.SetPairFacts(LaneAtom, OtherAtom, {
+				"overlaps(" + LaneAtom + ", " + OtherAtom + ").",
+				"overlaps(" + OtherAtom + ", " + LaneAtom + ")."
+			});
+			OutConflicts.SetConflict(LaneIndices[i], LaneIndices[j], true);
+		}
+	}
+}
+
+
+bool FIntersectionLayout::SegmentsOverlap(const FLaneGeometry& A, const FLaneGeometry& B)
+{
+	// Spline meshes are unit cubes, 100 cm wide at scale 1
+	auto HalfWidth = [](const FLaneSegment& Segment) {
+		return 50.f * FMath::Max(Segment.StartScale.X, Segment.EndScale.X);
+	};
+	auto Flat = [](const FVector& Position) {
+		return FVector(Position.X, Position.Y, 0.f);
+	};
+	auto Bounds = [&HalfWidth](const FLaneGeometry& Geometry) {
+		FBox2D Box(ForceInit);
+		for (const FLaneSegment& Segment : Geometry.Segments)
+		{
+			FVector2D Extent(HalfWidth(Segment), HalfWidth(Segment));
+			Box += FVector2D(Segment.StartPosition) - Extent;
+			Box += FVector2D(Segment.StartPosition) + Extent;
+			Box += FVector2D(Segment.EndPosition) - Extent;
+			Box += FVector2D(Segment.EndPosition) + Extent;
+		}
+		return Box;
+	};
+	if (!Bounds(A).Intersect(Bounds(B)))
+	{
+		return false;
+	}
+
+	for (const FLaneSegment& SegmentA : A.Segments)
+	{
+		FVector A0 = Flat(SegmentA.StartPosition);
+		FVector A1 = Flat(SegmentA.EndPosition);
+		for (const FLaneSegment& SegmentB : B.Segments)
+		{
+			FVector B0 = Flat(SegmentB.StartPosition);
+			FVector B1 = Flat(SegmentB.EndPosition);
+			FVector Intersection;
+			if (FMath::SegmentIntersection2D(A0, A1, B0, B1, Intersection))
+			{
+				return true;
+			}
+			float Distance = FMath::Min(
+				FMath::Min(FMath::PointDistToSegment(A0, B0, B1), FMath::PointDistToSegment(A1, B0, B1)),
+				FMath::Min(FMath::PointDistToSegment(B0, A0, A1), FMath::PointDistToSegment(B1, A0, A1)));
+			if (Distance < HalfWidth(SegmentA) + HalfWidth(SegmentB))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+
+AIntersectionMonitor* FIntersectionLayout::Spawn(UWorld* World, const FTransform& Transform) const
+{
+	auto EndpointTransform = [&Transform](const FLayoutEndpoint& Endpoint) {
+		return FTransform(Endpoint.Direction.Rotation(), Endpoint.Location) * Transform;
+	};
+
+	TArray<AFork*> SpawnedForks;
+	for (const FLayoutEndpoint& Endpoint : Forks)
+	{
+		AFork* Fork = SpawnNamed<AFork>(World, Endpoint.Name, EndpointTransform(Endpoint));
+		Fork->EntranceTriggerVolume->SetBoxExtent(FVector{ 50.f, LaneWidth / 2.f, 50.f });
+		Fork->ArrivalTriggerVolume->SetBoxExtent(FVector{ 200.f, LaneWidth / 2.f, 50.f });
+		SpawnedForks.Add(Fork);
+	}
+	TArray<AExit*> SpawnedExits;
+	for (const FLayoutEndpoint& Endpoint : Exits)
+	{
+		AExit* Exit = SpawnNamed<AExit>(World, Endpoint.Name, EndpointTransform(Endpoint));
+		Exit->TriggerVolume->SetBoxExtent(FVector{ 20.f, LaneWidth / 2.f, 50.f });
+		SpawnedExits.Add(Exit);
+		for (AFork* Fork : SpawnedForks)
+		{
+			Fork->AddExit(Exit);
+		}
+	}
+
+	// As AFork::UpdateLanes does for checked exits
+	TArray<ALane*> SpawnedLanes;
+	for (const FLayoutLane& Lane : Lanes)
+	{
+		AFork* Fork = SpawnedForks[Lane.Fork];
+		AExit* Exit = SpawnedExits[Lane.Exit];
+		ALane* SpawnedLane = SpawnNamed<ALane>(World, Fork->GetName() + "_to_" + Exit->GetName(), FTransform::Identity);
+		SpawnedLane->MaxMeshLength = MaxMeshLength;
+		SpawnedLane->Init(Fork, Exit);
+		for (FExitCheckbox& ExitCheckbox : Fork->Exits)
+		{
+			if (ExitCheckbox.Exit == Exit)
+			{
+				ExitCheckbox.bActive = true;
+				ExitCheckbox.Lane = SpawnedLane;
+			}
+		}
+		SpawnedLanes.Add(SpawnedLane);
+	}
+	ALane::BuildLanes(SpawnedLanes);
+
+	// Arrival triggers reach 400 cm behind the forks
+	AIntersectionMonitor* Monitor = SpawnNamed<AIntersectionMonitor>(World, TEXT("Monitor"), Transform);
+	Monitor->ExtentBox->SetBoxExtent(FVector{ Radius + 500.f, Radius + 500.f, 100.f });
+	return Monitor;
+}
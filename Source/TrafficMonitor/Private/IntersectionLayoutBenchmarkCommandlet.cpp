@@ -0,0 +1,112 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "IntersectionLayoutBenchmarkCommandlet.h"
+#include "Async/ParallelFor.h"
+#include "Runtime/Core/Public/Misc/FileHelper.h"
+#include "Runtime/Core/Public/Misc/Paths.h"
+
+// Developer
+#include "IntersectionLayout.h"
+
+
+UIntersectionLayoutBenchmarkCommandlet::UIntersectionLayoutBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+
+int32 UIntersectionLayoutBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 MinApproaches = 3;
+	int32 MaxApproaches = 8;
+	int32 MaxLanesPerApproach = 3;
+	int32 NumRepeats = 5;
+	int32 Seed = 0;
+	FIntersectionLayoutSettings Settings;
+	Settings.AngleJitter = 10.f;
+	FParse::Value(*Params, TEXT("MinApproaches="), MinApproaches);
+	FParse::Value(*Params, TEXT("MaxApproaches="), MaxApproaches);
+	FParse::Value(*Params, TEXT("MaxLanesPerApproach="), MaxLanesPerApproach);
+	FParse::Value(*Params, TEXT("Repeats="), NumRepeats);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("AngleJitter="), Settings.AngleJitter);
+	Settings.bAllExitLanes = !FParse::Param(*Params, TEXT("MatchingLanes"));
+	Settings.bUTurns = FParse::Param(*Params, TEXT("UTurns"));
+	NumRepeats = FMath::Max(NumRepeats, 1);
+
+	FString Csv = TEXT("Approaches,LanesPerApproach,Forks,Lanes,MeshComponents,OverlappingPairs,Facts,ProgramBytes,FitMs,ParallelFitMs,FactsMs\n");
+	UE_LOG(LogTemp, Display, TEXT("Approaches x lanes: forks, lanes, mesh components, overlapping pairs, facts, program KB | fit ms, parallel fit ms, facts ms"));
+	for (int32 NumApproaches = MinApproaches; NumApproaches <= MaxApproaches; NumApproaches++)
+	{
+		for (int32 LanesPerApproach = 1; LanesPerApproach <= MaxLanesPerApproach; LanesPerApproach++)
+		{
+			Settings.NumApproaches = NumApproaches;
+			Settings.LanesPerApproach = LanesPerApproach;
+
+			double FitSeconds = 0.0;
+			double ParallelFitSeconds = 0.0;
+			double FactSeconds = 0.0;
+			FIntersectionLayout Layout;
+			TArray<FLaneGeometry> Geometries;
+			FGeometryFacts Facts;
+			FLaneConflictMatrix Conflicts;
+			for (int32 Repeat = 0; Repeat < NumRepeats; Repeat++)
+			{
+				FRandomStream Random(Seed + Repeat);
+				Layout = FIntersectionLayout::Generate(Settings, Random);
+				TArray<FLaneEndpoints> Endpoints = Layout.GetLaneEndpoints();
+
+				// On one thread, as the lanes were fitted one by one before ALane::BuildLanes
+				double StartTime = FPlatformTime::Seconds();
+				Geometries.Reset();
+				for (const FLaneEndpoints& LaneEndpoints : Endpoints)
+				{
+					Geometries.Add(ALane::ComputeGeometry(LaneEndpoints));
+				}
+				FitSeconds += FPlatformTime::Seconds() - StartTime;
+
+				StartTime = FPlatformTime::Seconds();
+				ParallelFor(Endpoints.Num(), [&Endpoints, &Geometries](int32 i) {
+					Geometries[i] = ALane::ComputeGeometry(Endpoints[i]);
+				});
+				ParallelFitSeconds += FPlatformTime::Seconds() - StartTime;
+
+				StartTime = FPlatformTime::Seconds();
+				Layout.ExtractGeometryFacts(Geometries, Facts, Conflicts);
+				Facts.GetProgram();
+				FactSeconds += FPlatformTime::Seconds() - StartTime;
+			}
+
+			int32 NumMeshes = 0;
+			for (const FLaneGeometry& Geometry : Geometries)
+			{
+				NumMeshes += Geometry.Segments.Num();
+			}
+			int32 NumOverlappingPairs = 0;
+			for (int32 Lane = 0; Lane < Conflicts.Num(); Lane++)
+			{
+				NumOverlappingPairs += Conflicts.GetConflicts(Lane).CountSetBits() - 1; // Not itself
+			}
+			NumOverlappingPairs /= 2;
+			int32 ProgramBytes = int32(Facts.GetProgram().size());
+			double FitMs = 1000.0 * FitSeconds / NumRepeats;
+			double ParallelFitMs = 1000.0 * ParallelFitSeconds / NumRepeats;
+			double FactsMs = 1000.0 * FactSeconds / NumRepeats;
+
+			UE_LOG(LogTemp, Display, TEXT("%d x %d: %d, %d, %d, %d, %d, %.1f | %.2f, %.2f, %.2f"),
+				NumApproaches, LanesPerApproach, Layout.Forks.Num(), Layout.Lanes.Num(), NumMeshes, NumOverlappingPairs,
+				Facts.Num(), ProgramBytes / 1024.f, FitMs, ParallelFitMs, FactsMs);
+			Csv += FString::Printf(TEXT("%d,%d,%d,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f\n"),
+				NumApproaches, LanesPerApproach, Layout.Forks.Num(), Layout.Lanes.Num(), NumMeshes, NumOverlappingPairs,
+				Facts.Num(), ProgramBytes, FitMs, ParallelFitMs, FactsMs);
+		}
+	}
+
+	FString FileName = FPaths::ProjectSavedDir() + TEXT("IntersectionLayoutBenchmark.csv");
+	FFileHelper::SaveStringToFile(Csv, *FileName);
+	UE_LOG(LogTemp, Display, TEXT("Wrote %s"), *FileName);
+	return 0;
+}
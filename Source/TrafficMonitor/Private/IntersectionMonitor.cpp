@@ -4,24 +4,26 @@
 #include "IntersectionMonitor.h"
 #include "Runtime/CoreUObject/Public/UObject/ConstructorHelpers.h"
 #include "Runtime/Core/Public/Misc/Paths.h"
+#include "Runtime/Core/Public/Misc/FileHelper.h"
+#include "Runtime/Core/Public/Serialization/MemoryReader.h"
+#include "Runtime/Core/Public/Serialization/MemoryWriter.h"
 #include "Runtime/Engine/Classes/Kismet/KismetMathLibrary.h"
 #include "Runtime/Engine/Classes/Kismet/GameplayStatics.h"
+#include "EngineUtils.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "GameFramework/Pawn.h"
 
-// Carla
-#include "Vehicle/WheeledVehicleAIController.h"
-
-
-// Clingo staticly linked library
-THIRD_PARTY_INCLUDES_START
-#pragma push_macro("check")
-#undef check
-#include <clingo.hh>
-#pragma pop_macro("check")
-THIRD_PARTY_INCLUDES_END
+#include "ClingoInclude.h"
 
 
 // Developer
+#include "DistanceTimeCurve.h"
 #include "Fork.h"
+#include "MonitorScheduler.h"
+#include "SolverServiceClient.h"
+#include "TriggerCollision.h"
+#include "VehicleRegistry.h"
 
 
 // STL
@@ -37,6 +39,10 @@ AIntersectionMonitor::AIntersectionMonitor(const FObjectInitializer &ObjectIniti
 		ObjectInitializer.CreateDefaultSubobject<USceneComponent>(this, TEXT("SceneRootComponent"));
 	RootComponent->SetMobility(EComponentMobility::Static);
 
+	// Ticks only while starting, waiting for the solver service or recording trajectories
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
 	static ConstructorHelpers::FObjectFinder<UTexture2D> MonitorBillboardAsset(TEXT("Texture2D'/TrafficMonitor/Monitor.Monitor'"));
 	Billboard = ObjectInitializer.CreateEditorOnlyDefaultSubobject<UBillboardComponent>(this, TEXT("Billboard"), true);
 	if (MonitorBillboardAsset.Object != nullptr && Billboard != nullptr)
@@ -54,8 +60,7 @@ AIntersectionMonitor::AIntersectionMonitor(const FObjectInitializer &ObjectIniti
 	ExtentBox->SetupAttachment(RootComponent);
 	ExtentBox->SetHiddenInGame(true);
 	ExtentBox->SetMobility(EComponentMobility::Static);
-	ExtentBox->SetCollisionProfileName(FName("OverlapAll"));
-	ExtentBox->SetGenerateOverlapEvents(true);
+	TriggerCollision::SetupTrigger(ExtentBox);
 	ExtentBox->SetBoxExtent(FVector{ 1800.0f, 1800.0f, 100.0f });
 	ExtentBox->ShapeColor = FColor(255, 255, 255);
 }
@@ -77,19 +82,91 @@ void AIntersectionMonitor::OnConstruction(const FTransform &Transform)
 }
 
 
+#if WITH_EDITOR
+void AIntersectionMonitor::GenerateAllLanes()
+{
+	TArray<AFork*> MyForks;
+	GetIntersectingActors<AFork>(MyForks);
+	TArray<ALane*> Lanes;
+	for (AFork* Fork : MyForks)
+	{
+		Fork->UpdateLanes();
+		for (const FExitCheckbox& ExitCheckbox : Fork->Exits)
+		{
+			if (ExitCheckbox.Lane != nullptr)
+			{
+				Lanes.Add(ExitCheckbox.Lane);
+			}
+		}
+	}
+	ALane::BuildLanes(Lanes);
+	UE_LOG(LogTemp, Log, TEXT("%s generated %d lanes."), *GetName(), Lanes.Num());
+}
+#endif // WITH_EDITOR
+
+
 // Called when the game starts or when spawned
 void AIntersectionMonitor::BeginPlay()
 {
 	Super::BeginPlay();
 
-	CreateLogFile();
-
+	// Only the actor queries and the trigger bindings run here. The files, facts and rules are prepared on the
+	// thread pool, in parallel with the other monitors, and events are held back until they are ready.
+	VehicleRegistry = GetWorld()->GetSubsystem<UVehicleRegistry>();
+	if (VehicleRegistry == nullptr)
+	{
+		// Without triggers nor startup the monitor never sees a vehicle, so nothing else uses the registry
+		UE_LOG(LogTemp, Error, TEXT("%s found no vehicle registry in its world, monitoring nothing!"), *GetName());
+		return;
+	}
 	SetupTriggers();
+	FMonitorStartupInput Input = GetStartupInput();
+	FAnalyticsLog* AnalyticsLog = &Analytics;
+	Startup = Async(EAsyncExecution::ThreadPool, [Input, AnalyticsLog]() {
+		return RunStartup(Input, AnalyticsLog);
+	});
+	SetActorTickEnabled(true);
+}
 
-	LoadGeometryFacts();
-	WriteGeometryToFile();
 
-	LoadTrafficRules();
+void AIntersectionMonitor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// The startup task writes to the analytics log
+	if (Startup.IsValid())
+	{
+		Startup.Wait();
+	}
+	DeferredEvents.Empty();
+	DeferredGeometryChanges.Empty();
+	for (TConstSetBitIterator<> It(TrackedVehicles); It; ++It)
+	{
+		VehicleRegistry->Release(It.GetIndex());
+	}
+	TrackedVehicles.Empty();
+
+	if (UMonitorScheduler* Scheduler = GetWorld()->GetSubsystem<UMonitorScheduler>())
+	{
+		Scheduler->CancelSolve(this);
+	}
+	for (uint64 Ticket : ServiceTickets)
+	{
+		FSolverServiceClient::Get().Discard(Ticket);
+	}
+	ServiceTickets.Empty();
+	LogStatistics();
+	for (auto& Pair : Trajectories)
+	{
+		FinishTrajectory(Pair.Key, Pair.Value);
+	}
+	Trajectories.Empty();
+	Analytics.Close();
+	if (ShadowEvaluator.IsValid())
+	{
+		ShadowEvaluator->LogStatistics();
+		ShadowEvaluator.Reset();
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 
@@ -98,363 +175,1819 @@ void AIntersectionMonitor::SetupTriggers()
 	ExtentBox->OnComponentEndOverlap.AddDynamic(this, &AIntersectionMonitor::OnExitMonitor);
 
 	TArray<AActor *> OverlappingActors;
-	GetOverlappingActors(OverlappingActors);
-	for (AActor* Actor : OverlappingActors)
+	TriggerCollision::GetOverlappingTriggerActors(this, ALane::StaticClass(), OverlappingActors);
+	for (AActor* Lane : OverlappingActors)
 	{
-		ALane* Lane = Cast<ALane>(Actor);
-		AFork* Fork = Cast<AFork>(Actor);
-		if (Lane != nullptr)
-		{
-			Lane->OnActorBeginOverlap.AddDynamic(this, &AIntersectionMonitor::OnEnterLane);
-			Lane->OnActorEndOverlap.AddDynamic(this, &AIntersectionMonitor::OnExitLane);
-		}
-		else if (Fork != nullptr)
-		{
-			Fork->ArrivalTriggerVolume->OnComponentBeginOverlap.AddDynamic(this, &AIntersectionMonitor::OnArrival);
-			Fork->EntranceTriggerVolume->OnComponentBeginOverlap.AddDynamic(this, &AIntersectionMonitor::OnEntrance);
-		}
+		BindLane(Cast<ALane>(Lane), true);
+	}
+	TriggerCollision::GetOverlappingTriggerActors(this, AFork::StaticClass(), OverlappingActors);
+	for (AActor* Fork : OverlappingActors)
+	{
+		BindFork(Cast<AFork>(Fork), true);
 	}
 }
 
 
-void AIntersectionMonitor::CreateLogFile()
+void AIntersectionMonitor::BindFork(AFork* Fork, bool bBind)
 {
-	// Init logfile name and path
-	LogFileName = GetName() + "Log.cl";
-	LogFileFullName = FPaths::ProjectSavedDir() + LogFileName;
+	if (bBind)
+	{
+		Fork->ArrivalTriggerVolume->OnComponentBeginOverlap.AddDynamic(this, &AIntersectionMonitor::OnArrival);
+		Fork->ArrivalTriggerVolume->OnComponentEndOverlap.AddDynamic(this, &AIntersectionMonitor::OnLeaveTrigger);
+		Fork->EntranceTriggerVolume->OnComponentBeginOverlap.AddDynamic(this, &AIntersectionMonitor::OnEntrance);
+		Fork->EntranceTriggerVolume->OnComponentEndOverlap.AddDynamic(this, &AIntersectionMonitor::OnLeaveTrigger);
+		ForkTriggers.Add(Fork->ArrivalTriggerVolume);
+		ForkTriggers.Add(Fork->EntranceTriggerVolume);
+	}
+	else
+	{
+		Fork->ArrivalTriggerVolume->OnComponentBeginOverlap.RemoveDynamic(this, &AIntersectionMonitor::OnArrival);
+		Fork->ArrivalTriggerVolume->OnComponentEndOverlap.RemoveDynamic(this, &AIntersectionMonitor::OnLeaveTrigger);
+		Fork->EntranceTriggerVolume->OnComponentBeginOverlap.RemoveDynamic(this, &AIntersectionMonitor::OnEntrance);
+		Fork->EntranceTriggerVolume->OnComponentEndOverlap.RemoveDynamic(this, &AIntersectionMonitor::OnLeaveTrigger);
+		ForkTriggers.Remove(Fork->ArrivalTriggerVolume);
+		ForkTriggers.Remove(Fork->EntranceTriggerVolume);
+	}
+}
 
-	// Create the logfile 
-	std::ofstream LogFile(TCHAR_TO_UTF8(*LogFileFullName), std::ios::trunc);
 
-	// Close the file stream explicitly
-	LogFile.close();
+void AIntersectionMonitor::BindLane(ALane* Lane, bool bBind)
+{
+	if (bBind)
+	{
+		Lane->OnActorBeginOverlap.AddDynamic(this, &AIntersectionMonitor::OnEnterLane);
+		Lane->OnActorEndOverlap.AddDynamic(this, &AIntersectionMonitor::OnExitLane);
+	}
+	else
+	{
+		Lane->OnActorBeginOverlap.RemoveDynamic(this, &AIntersectionMonitor::OnEnterLane);
+		Lane->OnActorEndOverlap.RemoveDynamic(this, &AIntersectionMonitor::OnExitLane);
+	}
 }
 
 
-void AIntersectionMonitor::LoadGeometryFacts()
+FMonitorStartupInput AIntersectionMonitor::GetStartupInput()
 {
-	// Get a list of Forks
+	FMonitorStartupInput Input;
+	LogFileName = GetName() + "Log.cl";
+	LogFileFullName = FPaths::ProjectSavedDir() + LogFileName;
+	Input.LogFileFullName = LogFileFullName;
+	Input.GeometryFileFullName = GetGeometryFileFullName();
+	if (bExportAnalytics)
+	{
+		Input.AnalyticsFileFullName = FPaths::ProjectSavedDir() + "Analytics/" + GetName() + FDateTime::Now().ToString(TEXT("_%Y%m%d_%H%M%S")) + ".tmal";
+	}
+	Input.TrafficRulesFileFullName = FTrafficRules::GetRulesFileFullName(TrafficRulesFile);
+	if (!ShadowTrafficRulesFile.IsEmpty())
+	{
+		Input.ShadowTrafficRulesFileFullName = FTrafficRules::GetRulesFileFullName(ShadowTrafficRulesFile);
+	}
+
+	GeometryForks.Empty();
+	GeometryLanes.Empty();
 	TArray<AActor *> OverlappingActors;
-	GetOverlappingActors(OverlappingActors);
-	TArray<AFork *> Forks;
+	TriggerCollision::GetOverlappingTriggerActors(this, AFork::StaticClass(), OverlappingActors);
 	for (AActor* OverlappingActor : OverlappingActors)
 	{
 		AFork* Fork = Cast<AFork>(OverlappingActor);
-		if (Fork != nullptr)
-		{
-			Forks.Add(Fork);
-		}
+		GeometryForks.Add(Fork);
+		Input.Forks.Add(GetMonitoredFork(Fork));
+	}
+	TriggerCollision::GetOverlappingTriggerActors(this, ALane::StaticClass(), OverlappingActors);
+	for (AActor* OverlappingActor : OverlappingActors)
+	{
+		ALane* Lane = Cast<ALane>(OverlappingActor);
+		GeometryLanes.Add(Lane);
+		Input.Lanes.Add(GetMonitoredLane(Lane));
 	}
-	NumberOfForks = Forks.Num();
+	return Input;
+}
+
 
-	// "isToTheRightOf()" facts
-	for (size_t i = 0; i < NumberOfForks; i++)
+FMonitorStartup AIntersectionMonitor::RunStartup(const FMonitorStartupInput& Input, FAnalyticsLog* AnalyticsLog)
+{
+	FMonitorStartup Result;
+
+	std::ofstream LogFile(TCHAR_TO_UTF8(*Input.LogFileFullName), std::ios::trunc);
+	LogFile.close();
+	if (!Input.AnalyticsFileFullName.IsEmpty())
 	{
-		for (size_t j = i + 1; j < NumberOfForks; j++)
-		{
-			FString LeftFork = "f_";
-			FString RightFork = "f_";
-			if (Forks[i]->IsToTheRightOf(Forks[j])) // angle in (30, 150)
-			{
-				LeftFork += Forks[j]->GetName();
-				RightFork += Forks[i]->GetName();
-			}
-			else if (Forks[j]->IsToTheRightOf(Forks[i])) // angle in (-150, -30)
-			{
-				LeftFork += Forks[i]->GetName();
-				RightFork += Forks[j]->GetName();
-			}
-			else
-			{
-				continue;
-			}
-			FString FactString = "isToTheRightOf("
-				+ RightFork + ", "
-				+ LeftFork + ").";
-			Geometry += TCHAR_TO_ANSI(*FactString);
-			Geometry += "\n";
-		}
+		AnalyticsLog->Open(Input.AnalyticsFileFullName);
 	}
 
-	// Get a list of Lanes
-	TArray<ALane *> Lanes;
-	for (AActor* OverlappingActor : OverlappingActors)
+	// Dense lane indices, for the conflict matrix and the lane bitsets
+	TArray<FString> LaneAtoms;
+	for (const FMonitoredLane& Lane : Input.Lanes)
 	{
-		ALane* Lane = Cast<ALane>(OverlappingActor);
-		if (Lane != nullptr)
-		{
-			Lanes.Add(Lane);
-		}
+		Result.LaneConflicts.AddLane(Lane.Atom);
+		LaneAtoms.Add(Lane.Atom);
 	}
+	for (const FMonitoredFork& Fork : Input.Forks)
+	{
+		SetForkFacts(Fork, Input.Forks, Result.GeometryFacts, Result.AdjacentForks);
+	}
+	for (const FMonitoredLane& Lane : Input.Lanes)
+	{
+		SetLaneFacts(Lane, LaneAtoms, Result.GeometryFacts, Result.LaneConflicts, Result.LanesByForkAndSignal);
+	}
+	Result.Geometry = Result.GeometryFacts.GetProgram();
+	Result.ForksInCyclicOrder = GetForksInCyclicOrder(Input.Forks);
+	WriteGeometryToFile(Input.GeometryFileFullName, Result.Geometry);
 
-	// Graph connectivity
-	for (ALane* Lane : Lanes)
-	{
-		FString FactString = "laneFromTo(l_"
-			+ Lane->GetName() + ", f_"
-			+ Lane->MyFork->GetName() + ", e_"
-			+ Lane->MyExit->GetName() + ").";
-		Geometry += TCHAR_TO_ANSI(*FactString);
-		Geometry += "\n";
-		
-		FactString = "laneCorrectSignal(l_"
-			+ Lane->GetName() + ", "
-			+ Lane->GetCorrectSignal() + ").";
-		Geometry += TCHAR_TO_ANSI(*FactString);
-		Geometry += "\n";
+	// Parsed once per process, shared by all monitors selecting the same file
+	Result.TrafficRules = FTrafficRules::Get(Input.TrafficRulesFileFullName);
+	if (!Input.ShadowTrafficRulesFileFullName.IsEmpty())
+	{
+		Result.ShadowTrafficRules = FTrafficRules::Get(Input.ShadowTrafficRulesFileFullName);
 	}
+	return Result;
+}
 
-	// Lane overlaps
-	for (size_t i = 0; i < Lanes.Num(); i++)
+
+void AIntersectionMonitor::FinishStartup(const FMonitorStartup& Result)
+{
+	GeometryFacts = Result.GeometryFacts;
+	LaneConflicts = Result.LaneConflicts;
+	LanesByForkAndSignal = Result.LanesByForkAndSignal;
+	AdjacentForks = Result.AdjacentForks;
+	Geometry = Result.Geometry;
+	LaneOccupancy.Init(0, LaneConflicts.Num());
+	OccupiedLanes = LaneConflicts.MakeLaneSet();
+	DecisionCache.Reset(DecisionCacheCapacity);
+	DecisionCache.SetGeometry(Result.ForksInCyclicOrder, Geometry);
+
+	TrafficRules = Result.TrafficRules;
+	if (!TrafficRules.IsValid())
 	{
-		FString FactString = "overlaps(l_"
-			+ Lanes[i]->GetName() + ", l_"
-			+ Lanes[i]->GetName() + ").";
-		Geometry += TCHAR_TO_ANSI(*FactString);
-		Geometry += "\n";
-		for (size_t j = i + 1; j < Lanes.Num(); j++)
-		{
-			if (Lanes[i]->IsOverlappingActor(Lanes[j]))
-			{
-				FactString = "overlaps(l_"
-					+ Lanes[i]->GetName() + ", l_"
-					+ Lanes[j]->GetName() + ").";
-				Geometry += TCHAR_TO_ANSI(*FactString);
-				Geometry += "\n";
-				FactString = "overlaps(l_"
-					+ Lanes[j]->GetName() + ", l_"
-					+ Lanes[i]->GetName() + ").";
-				Geometry += TCHAR_TO_ANSI(*FactString);
-				Geometry += "\n";
-			}
-		}
+		UE_LOG(LogTemp, Error, TEXT("%s has no traffic rules to solve with!"), *GetName());
+	}
+	if (Result.ShadowTrafficRules.IsValid())
+	{
+		ShadowEvaluator = MakeUnique<FShadowEvaluator>(GetName(), Result.ShadowTrafficRules);
+	}
+	bReady = true;
+
+	// What happened while starting, in order
+	TArray<TWeakObjectPtr<AActor>> GeometryChanges = MoveTemp(DeferredGeometryChanges);
+	for (const TWeakObjectPtr<AActor>& Actor : GeometryChanges)
+	{
+		UpdateGeometryOf(Actor.Get());
 	}
+	TArray<FDeferredEvent> Events = MoveTemp(DeferredEvents);
+	for (FDeferredEvent& Event : Events)
+	{
+		ReplayTimeStep = Event.TimeStep;
+		Event.Replay();
+	}
+	ReplayTimeStep = INDEX_NONE;
+	UE_LOG(LogTemp, Log, TEXT("%s is ready after %d events and %d geometry changes."), *GetName(), Events.Num(), GeometryChanges.Num());
 }
 
 
-void AIntersectionMonitor::LoadTrafficRules()
+bool AIntersectionMonitor::DeferUntilReady(TFunction<void()>&& Replay)
 {
-	FString RulesFileFullName = FPaths::ProjectSavedDir() + "../Plugins/TrafficMonitor/LogicSolver/all-way-stop_new.cl";
-	std::ifstream RulesFile(TCHAR_TO_UTF8(*RulesFileFullName));
-	std::stringstream buffer;
-	buffer << RulesFile.rdbuf();
-	TrafficRules = buffer.str();
-	RulesFile.close();
+	if (bReady)
+	{
+		return false;
+	}
+	DeferredEvents.Add({ GetCurrentTimeStep(), MoveTemp(Replay) });
+	return true;
 }
 
 
-void AIntersectionMonitor::AddEvent(FString Actor, FString Atom)
+bool AIntersectionMonitor::DeferGeometryChange(AActor* Actor)
 {
-	// TODO: Use TimeStep to buffer concurrent events
-	FString& PreviousAtoms = ActorToEventsMap.FindOrAdd(Actor);
-	PreviousAtoms += Atom + "\n";
-	UE_LOG(LogTemp, Warning, TEXT("Event: %s"), *Atom);
+	if (bReady)
+	{
+		return false;
+	}
+	DeferredGeometryChanges.AddUnique(Actor);
+	return true;
 }
 
 
-void AIntersectionMonitor::AppendToLogfile(std::string Content)
+FMonitoredFork AIntersectionMonitor::GetMonitoredFork(const AFork* Fork)
 {
-	std::ofstream LogFile(TCHAR_TO_UTF8(*LogFileFullName), std::ios::app);
-	LogFile << Content << std::endl;
-	LogFile.close();
+	return { "f_" + Fork->GetName(), Fork->GetActorForwardVector() };
 }
 
 
-void AIntersectionMonitor::WriteGeometryToFile()
+FMonitoredLane AIntersectionMonitor::GetMonitoredLane(ALane* Lane)
 {
-	FString GeometryFileFullName = FPaths::ProjectSavedDir() + GetName() + "Geometry.cl";
-	std::ofstream GeometryFile(TCHAR_TO_UTF8(*GeometryFileFullName), std::ios::trunc);
-	GeometryFile << Geometry;
-	GeometryFile.close();
+	FMonitoredLane Monitored;
+	Monitored.Atom = "l_" + Lane->GetName();
+	Monitored.ForkAtom = "f_" + Lane->MyFork->GetName();
+	Monitored.ExitAtom = "e_" + Lane->MyExit->GetName();
+	Monitored.Signal = Lane->GetCorrectSignal();
+	TArray<AActor*> OverlappingLanes;
+	TriggerCollision::GetOverlappingTriggerActors(Lane, ALane::StaticClass(), OverlappingLanes);
+	for (AActor* OtherLane : OverlappingLanes)
+	{
+		Monitored.OverlappingLanes.Add("l_" + OtherLane->GetName());
+	}
+	return Monitored;
 }
 
-void AIntersectionMonitor::OnArrival(
-	UPrimitiveComponent* OverlappedComp,
-	AActor* OtherActor,
-	UPrimitiveComponent* OtherComp,
-	int32 OtherBodyIndex,
-	bool bFromSweep,
-	const FHitResult& SweepResult)
+
+TArray<FString> AIntersectionMonitor::GetForksInCyclicOrder() const
 {
-	int32 TimeStep = FMath::FloorToInt(GetWorld()->GetTimeSeconds() / TimeResolution);
-	FString ArrivingVehicleID = "v_" + OtherActor->GetName();
-	FString Fork = "f_" + OverlappedComp->GetOwner()->GetName();
-	FString EventAtom = "arrivesAtForkAtTime("
-		+ ArrivingVehicleID + ", "
-		+ Fork + ", "
-		+ FString::FromInt(TimeStep) + ").";
-	AddEvent(OtherActor->GetName(), EventAtom);
-
-	ACarlaWheeledVehicle* ArrivingVehicle = Cast<ACarlaWheeledVehicle>(OtherActor);
-	if (ArrivingVehicle != nullptr)
-	{
-		FString SignalString = ArrivingVehicle->GetSignalString();
-		EventAtom = "signalsAtForkAtTime("
-			+ ArrivingVehicleID + ", "
-			+ SignalString + ", "
-			+ Fork + ", "
-			+ FString::FromInt(TimeStep) + ").";
-		AddEvent(OtherActor->GetName(), EventAtom);
-		VehiclePointers.Add(OtherActor->GetName(), ArrivingVehicle);
+	TArray<FMonitoredFork> Forks;
+	for (AFork* Fork : GeometryForks)
+	{
+		Forks.Add(GetMonitoredFork(Fork));
 	}
-	else
+	return GetForksInCyclicOrder(Forks);
+}
+
+
+TArray<FString> AIntersectionMonitor::GetForksInCyclicOrder(TArray<FMonitoredFork> Forks)
+{
+	// Counterclockwise order of the approaches, for the decision cache's rotations
+	Forks.Sort([](const FMonitoredFork& A, const FMonitoredFork& B) {
+		return A.Direction.HeadingAngle() < B.Direction.HeadingAngle();
+	});
+	TArray<FString> ForksInCyclicOrder;
+	for (const FMonitoredFork& Fork : Forks)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("Cast to ACarlaWheeledVehicle failed!"));
+		ForksInCyclicOrder.Add(Fork.Atom);
 	}
+	return ForksInCyclicOrder;
+}
 
-	Solve();
+
+void AIntersectionMonitor::UpdateForkFacts(AFork* Fork)
+{
+	TArray<FMonitoredFork> Forks;
+	for (AFork* OtherFork : GeometryForks)
+	{
+		Forks.Add(GetMonitoredFork(OtherFork));
+	}
+	SetForkFacts(GetMonitoredFork(Fork), Forks, GeometryFacts, AdjacentForks);
 }
 
 
-void AIntersectionMonitor::OnEntrance(
-	UPrimitiveComponent* OverlappedComp,
-	AActor* OtherActor,
-	UPrimitiveComponent* OtherComp,
-	int32 OtherBodyIndex,
-	bool bFromSweep,
-	const FHitResult& SweepResult)
+void AIntersectionMonitor::UpdateLaneFacts(ALane* Lane)
 {
-	uint32 TimeStep = FMath::FloorToInt(GetWorld()->GetTimeSeconds() / TimeResolution);
-	FString EnteringVehicle = "v_" + OtherActor->GetName();
-	FString Fork = "f_" + OverlappedComp->GetOwner()->GetName();
-	FString Atom = "entersForkAtTime("
-		+ EnteringVehicle + ", "
-		+ Fork + ", "
-		+ FString::FromInt(TimeStep) + ").";
+	TArray<FString> LaneAtoms;
+	for (ALane* OtherLane : GeometryLanes)
+	{
+		LaneAtoms.Add("l_" + OtherLane->GetName());
+	}
+	SetLaneFacts(GetMonitoredLane(Lane), LaneAtoms, GeometryFacts, LaneConflicts, LanesByForkAndSignal);
+}
 
-	AddEvent(OtherActor->GetName(), Atom);
-	Solve();
+
+void AIntersectionMonitor::SetForkFacts(const FMonitoredFork& Fork, const TArray<FMonitoredFork>& Forks, FGeometryFacts& Facts, TSet<TPair<FString, FString>>& OutAdjacentForks)
+{
+	// "isToTheRightOf()" facts with every other fork
+	for (const FMonitoredFork& OtherFork : Forks)
+	{
+		if (OtherFork.Atom == Fork.Atom)
+		{
+			continue;
+		}
+		TArray<FString> PairFacts;
+		if (AFork::IsToTheRightOf(Fork.Direction, OtherFork.Direction)) // angle in (30, 150)
+		{
+			PairFacts.Add("isToTheRightOf(" + Fork.Atom + ", " + OtherFork.Atom + ").");
+		}
+		else if (AFork::IsToTheRightOf(OtherFork.Direction, Fork.Direction)) // angle in (-150, -30)
+		{
+			PairFacts.Add("isToTheRightOf(" + OtherFork.Atom + ", " + Fork.Atom + ").");
+		}
+		Facts.SetPairFacts(Fork.Atom, OtherFork.Atom, PairFacts);
+		if (PairFacts.Num() > 0)
+		{
+			OutAdjacentForks.Emplace(Fork.Atom, OtherFork.Atom);
+			OutAdjacentForks.Emplace(OtherFork.Atom, Fork.Atom);
+		}
+		else
+		{
+			OutAdjacentForks.Remove(TPair<FString, FString>(Fork.Atom, OtherFork.Atom));
+			OutAdjacentForks.Remove(TPair<FString, FString>(OtherFork.Atom, Fork.Atom));
+		}
+	}
 }
 
 
-void AIntersectionMonitor::OnEnterLane(AActor* ThisActor, AActor* OtherActor)
+void AIntersectionMonitor::SetLaneFacts(const FMonitoredLane& Lane, const TArray<FString>& LaneAtoms, FGeometryFacts& Facts, FLaneConflictMatrix& Conflicts, TMap<FString, TBitArray<>>& OutLanesByForkAndSignal)
 {
-		int32 TimeStep = FMath::FloorToInt(GetWorld()->GetTimeSeconds() / TimeResolution);
-		FString EnteringActorName = "v_" + OtherActor->GetName();
-		FString LaneName = "l_" + ThisActor->GetName();
-		FString Atom = "entersLaneAtTime("
-			+ EnteringActorName + ", "
-			+ LaneName + ", "
-			+ FString::FromInt(TimeStep) + ").";
-		AddEvent(OtherActor->GetName(), Atom);
-		Solve();
+	int32 LaneIndex = Conflicts.FindLane(Lane.Atom);
+
+	// Graph connectivity
+	Facts.SetFacts(Lane.Atom, {
+		"laneFromTo(" + Lane.Atom + ", " + Lane.ForkAtom + ", " + Lane.ExitAtom + ").",
+		"laneCorrectSignal(" + Lane.Atom + ", " + Lane.Signal + ").",
+		"overlaps(" + Lane.Atom + ", " + Lane.Atom + ")."
+	});
+	for (auto& Pair : OutLanesByForkAndSignal)
+	{
+		FLaneConflictMatrix::SetLane(Pair.Value, LaneIndex, false);
+	}
+	FLaneConflictMatrix::SetLane(OutLanesByForkAndSignal.FindOrAdd(Lane.ForkAtom + "/" + Lane.Signal), LaneIndex, true);
+
+	// Lane overlaps
+	for (const FString& OtherAtom : LaneAtoms)
+	{
+		if (OtherAtom == Lane.Atom)
+		{
+			continue;
+		}
+		bool bOverlaps = Lane.OverlappingLanes.Contains(OtherAtom);
+		TArray<FString> PairFacts;
+		if (bOverlaps)
+		{
+			PairFacts.Add("overlaps(" + Lane.Atom + ", " + OtherAtom + ").");
+			PairFacts.Add("overlaps(" + OtherAtom + ", " + Lane.Atom + ").");
+		}
+		Facts.SetPairFacts(Lane.Atom, OtherAtom, PairFacts);
+		Conflicts.SetConflict(LaneIndex, Conflicts.FindLane(OtherAtom), bOverlaps);
+	}
 }
 
 
-void AIntersectionMonitor::OnExitLane(AActor* ThisActor, AActor* OtherActor)
+void AIntersectionMonitor::UpdateFork(AFork* Fork)
 {
-		int32 TimeStep = FMath::FloorToInt(GetWorld()->GetTimeSeconds() / TimeResolution);
-		FString ExitingActorName = "v_" + OtherActor->GetName();
-		FString LaneName = "l_" + ThisActor->GetName();
-		FString Atom = "leavesLaneAtTime("
-			+ ExitingActorName + ", "
-			+ LaneName + ", "
-			+ FString::FromInt(TimeStep) + ").";
-		//UE_LOG(LogTemp, Warning, TEXT("%s"), *(Atom));
-		AddEvent(OtherActor->GetName(), Atom);
-		Solve();
+	if (Fork == nullptr || DeferGeometryChange(Fork))
+	{
+		return;
+	}
+	FString ForkAtom = "f_" + Fork->GetName();
+	bool bMonitored = GeometryForks.Contains(Fork);
+	if (!TriggerCollision::TriggersOverlap(this, Fork))
+	{
+		if (!bMonitored)
+		{
+			return;
+		}
+		GeometryForks.Remove(Fork);
+		BindFork(Fork, false);
+		GeometryFacts.Remove(ForkAtom);
+		for (auto It = AdjacentForks.CreateIterator(); It; ++It)
+		{
+			if (It->Key == ForkAtom || It->Value == ForkAtom)
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
+	else
+	{
+		if (!bMonitored)
+		{
+			GeometryForks.Add(Fork);
+			BindFork(Fork, true);
+		}
+		UpdateForkFacts(Fork);
+
+		// The lanes' signals depend on their fork's heading
+		for (ALane* Lane : GeometryLanes)
+		{
+			if (Lane->MyFork == Fork)
+			{
+				UpdateLaneFacts(Lane);
+			}
+		}
+	}
+	OnGeometryChanged();
 }
 
 
-void AIntersectionMonitor::OnExitMonitor(
-	UPrimitiveComponent* OverlappedComp,
-	AActor* OtherActor,
-	UPrimitiveComponent* OtherComp,
-	int32 OtherBodyIndex)
+void AIntersectionMonitor::UpdateExit(AExit* Exit)
 {
-	ActorToEventsMap.Remove(OtherActor->GetName());
-	VehiclePointers.Remove(OtherActor->GetName());
-	Solve();
+	if (Exit == nullptr || DeferGeometryChange(Exit))
+	{
+		return;
+	}
+	bool bChanged = false;
+	for (ALane* Lane : GeometryLanes)
+	{
+		if (Lane->MyExit == Exit)
+		{
+			UpdateLaneFacts(Lane);
+			bChanged = true;
+		}
+	}
+	if (bChanged)
+	{
+		OnGeometryChanged();
+	}
 }
 
 
-std::string AIntersectionMonitor::GetEventsString()
+void AIntersectionMonitor::UpdateLane(ALane* Lane)
 {
-	FString EventsString;
-	for (auto& Pair : ActorToEventsMap)
+	if (Lane == nullptr || DeferGeometryChange(Lane))
 	{
-		EventsString += Pair.Value;
+		return;
 	}
-	return std::string(TCHAR_TO_ANSI(*EventsString));
+	FString LaneAtom = "l_" + Lane->GetName();
+	bool bMonitored = GeometryLanes.Contains(Lane);
+	if (!TriggerCollision::TriggersOverlap(this, Lane) || Lane->MyFork == nullptr || Lane->MyExit == nullptr)
+	{
+		if (!bMonitored)
+		{
+			return;
+		}
+		// Its index stays allocated, with no conflicts and in no fork's lanes
+		GeometryLanes.Remove(Lane);
+		BindLane(Lane, false);
+		GeometryFacts.Remove(LaneAtom);
+		int32 LaneIndex = LaneConflicts.FindLane(LaneAtom);
+		for (int32 Other = 0; Other < LaneConflicts.Num(); Other++)
+		{
+			LaneConflicts.SetConflict(LaneIndex, Other, false);
+		}
+		for (auto& Pair : LanesByForkAndSignal)
+		{
+			FLaneConflictMatrix::SetLane(Pair.Value, LaneIndex, false);
+		}
+	}
+	else
+	{
+		if (!bMonitored)
+		{
+			GeometryLanes.Add(Lane);
+			BindLane(Lane, true);
+			LaneConflicts.AddLane(LaneAtom);
+			LaneOccupancy.Add(0);
+			OccupiedLanes.Add(false);
+		}
+		UpdateLaneFacts(Lane);
+	}
+	OnGeometryChanged();
 }
 
 
-void AIntersectionMonitor::Solve()
+void AIntersectionMonitor::OnGeometryChanged()
 {
-	try {
-		Clingo::Logger logger = [](Clingo::WarningCode, char const *message) {
-			//UE_LOG(LogTemp, Warning, TEXT("Clingo logger message: %s"), ANSI_TO_TCHAR(message));
-		};
-		
-		//std::string ProgramTitle = "#program time_" 
-		//	+ std::to_string(FMath::FloorToInt(GetWorld()->GetTimeSeconds() * 1000))
-		//	+ ".\n";
-		std::string EventsString = GetEventsString();
-		//AppendToLogfile(ProgramTitle + EventsString);
-
-		// Without the "-n 0" option, at most one model is found.
-		Clingo::Control ctl{ {}, logger, 20 };
-
-		ctl.add("base", {}, EventsString.c_str());
-		ctl.add("base", {}, Geometry.c_str());
-		ctl.add("base", {}, TrafficRules.c_str());
-
-		ctl.ground({ {"base", {}} });
-		auto solveHandle = ctl.solve();
-		auto solveResult = solveHandle.get();
-		if (solveResult.is_unsatisfiable())
-		{
-			UE_LOG(LogTemp, Error, TEXT("Not satisfiable!"));
-		}
-		if (solveResult.is_unknown())
-		{
-			UE_LOG(LogTemp, Error, TEXT("Satisfiability is unknown!"));
-		}
-		
-		for (auto &model : solveHandle) {
-			FString Model;
-			for (auto &atom : model.symbols()) {
-				if (atom.match("mustYieldToForRule", 3))
-				{
-					FString YieldingVehicleName = FString(atom.arguments()[0].name()).RightChop(2);
-					ACarlaWheeledVehicle* YieldingVehicle = VehiclePointers[YieldingVehicleName];
-					AWheeledVehicleAIController* Controller = Cast<AWheeledVehicleAIController>(YieldingVehicle->GetController());
-					if (Controller != nullptr)
-					{
-						Controller->SetTrafficLightState(ETrafficLightState::Red);
-						UE_LOG(LogTemp, Warning, TEXT("Setting %s's controller to yield!"), *YieldingVehicleName);
-					}
-					else
-					{
-						UE_LOG(LogTemp, Warning, TEXT("%s's controller not found! (mustYield)"), *YieldingVehicleName);
-					}
-				}
-				else if (atom.match("hasRightOfWay", 1))
-				{
-					FString VehicleName = FString(atom.arguments()[0].name()).RightChop(2);
-					ACarlaWheeledVehicle* Vehicle = VehiclePointers[VehicleName];
-					AWheeledVehicleAIController* Controller = Cast<AWheeledVehicleAIController>(Vehicle->GetController());
-					if (Controller != nullptr)
-					{
-						Controller->SetTrafficLightState(ETrafficLightState::Green);
-					}
-					else
-					{
-						UE_LOG(LogTemp, Warning, TEXT("%s's controller not found! (hasRightOfWay)"), *VehicleName);
-					}					
-				}
-				FString AtomString(atom.to_string().c_str());
-				Model.Append("\t" + AtomString + "\n");
-			}
-			UE_LOG(LogTemp, Error, TEXT("Clingo Model:\n%s\n"), *Model);
+	Geometry = GeometryFacts.GetProgram();
+	WriteGeometryToFile();
 
-		}
+	// Wanted lanes depend on the forks' lanes and their signals
+	RebuildVehicleStates();
+
+	// Decisions cached for the old geometry may not hold anymore
+	DecisionCache.Reset(DecisionCacheCapacity);
+	DecisionCache.SetGeometry(GetForksInCyclicOrder(), Geometry);
+
+	// The geometry is part of every program, so the next solve already uses the new facts
+	if (ActorToEventsMap.Num() > 0)
+	{
+		RequestSolve();
+	}
+}
+
+
+void AIntersectionMonitor::NotifyGeometryChanged(AActor* Actor)
+{
+	UWorld* World = Actor != nullptr ? Actor->GetWorld() : nullptr;
+	if (World == nullptr || !World->IsGameWorld())
+	{
+		return;
 	}
-	catch (std::exception const &e) {
-		UE_LOG(LogTemp, Warning, TEXT("Clingo failed with: %s"), ANSI_TO_TCHAR(e.what()));
+	for (TActorIterator<AIntersectionMonitor> It(World); It; ++It)
+	{
+		if (It->HasActorBegunPlay())
+		{
+			It->UpdateGeometryOf(Actor);
+		}
 	}
 }
 
+
+void AIntersectionMonitor::UpdateGeometryOf(AActor* Actor)
+{
+	if (AFork* Fork = Cast<AFork>(Actor))
+	{
+		UpdateFork(Fork);
+	}
+	else if (AExit* Exit = Cast<AExit>(Actor))
+	{
+		UpdateExit(Exit);
+	}
+	else if (ALane* Lane = Cast<ALane>(Actor))
+	{
+		UpdateLane(Lane);
+	}
+}
+
+
+void AIntersectionMonitor::SetTrafficRules(const FString& RulesFile, TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> NewRules)
+{
+	TrafficRulesFile = RulesFile;
+	TrafficRules = NewRules;
+
+	// Requests in flight and cached decisions are of the previous rules
+	for (uint64 Ticket : ServiceTickets)
+	{
+		FSolverServiceClient::Get().Discard(Ticket);
+	}
+	ServiceTickets.Empty();
+	SetActorTickEnabled(Trajectories.Num() > 0);
+	DecisionCache.Reset(DecisionCacheCapacity);
+	DecisionCache.SetGeometry(GetForksInCyclicOrder(), Geometry);
+
+	if (ActorToEventsMap.Num() > 0)
+	{
+		RequestSolve();
+	}
+}
+
+
+void AIntersectionMonitor::AddEvent(FString Actor, FMonitorEvent Event)
+{
+	// TODO: Use TimeStep to buffer concurrent events
+	UE_LOG(LogTemp, Warning, TEXT("Event: %s"), *Event.ToAtom());
+	Analytics.AddEvent(GetWorld()->GetTimeSeconds(), Event);
+	VehicleStates.Apply(Actor, Event, LaneConflicts, LanesByForkAndSignal);
+	TArray<FMonitorEvent>& PreviousEvents = ActorToEventsMap.FindOrAdd(Actor);
+	PreviousEvents.Add(MoveTemp(Event));
+}
+
+
+void AIntersectionMonitor::AppendToLogfile(std::string Content)
+{
+	std::ofstream LogFile(TCHAR_TO_UTF8(*LogFileFullName), std::ios::app);
+	LogFile << Content << std::endl;
+	LogFile.close();
+}
+
+
+FString AIntersectionMonitor::GetGeometryFileFullName() const
+{
+	return FPaths::ProjectSavedDir() + GetName() + "Geometry.cl";
+}
+
+
+void AIntersectionMonitor::WriteGeometryToFile()
+{
+	WriteGeometryToFile(GetGeometryFileFullName(), Geometry);
+}
+
+
+void AIntersectionMonitor::WriteGeometryToFile(const FString& GeometryFileFullName, const std::string& Program)
+{
+	std::ofstream GeometryFile(TCHAR_TO_UTF8(*GeometryFileFullName), std::ios::trunc);
+	GeometryFile << Program;
+	GeometryFile.close();
+}
+
+void AIntersectionMonitor::OnArrival(
+	UPrimitiveComponent* OverlappedComp,
+	AActor* OtherActor,
+	UPrimitiveComponent* OtherComp,
+	int32 OtherBodyIndex,
+	bool bFromSweep,
+	const FHitResult& SweepResult)
+{
+	TWeakObjectPtr<UPrimitiveComponent> Trigger(OverlappedComp);
+	TWeakObjectPtr<AActor> Vehicle(OtherActor);
+	if (DeferUntilReady([this, Trigger, Vehicle]() {
+		if (Trigger.IsValid() && Vehicle.IsValid())
+		{
+			OnArrival(Trigger.Get(), Vehicle.Get(), nullptr, INDEX_NONE, false, FHitResult());
+		}
+	}))
+	{
+		return;
+	}
+	if (!EnterTrigger(OverlappedComp, OtherActor))
+	{
+		return;
+	}
+
+	int32 TimeStep = GetCurrentTimeStep();
+	int32 VehicleId = TrackVehicle(OtherActor);
+	const FRegisteredVehicle& Registered = VehicleRegistry->Get(VehicleId);
+	FString Fork = "f_" + OverlappedComp->GetOwner()->GetName();
+	FMonitorEvent Event("arrivesAtForkAtTime", { Registered.Atom, Fork }, TimeStep);
+	AddEvent(Registered.Name, Event);
+
+	TBitArray<>& WantedLanes = WaitingVehicleLanes.FindOrAdd(Registered.Name);
+	FString SignalString;
+	if (VehicleRegistry->GetSignal(VehicleId, SignalString))
+	{
+		AddEvent(Registered.Name, FMonitorEvent("signalsAtForkAtTime", { Registered.Atom, SignalString, Fork }, TimeStep));
+		if (const TBitArray<>* Lanes = LanesByForkAndSignal.Find(Fork + "/" + SignalString))
+		{
+			FLaneConflictMatrix::UnionWith(WantedLanes, *Lanes);
+		}
+	}
+	else
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s is neither a CARLA vehicle nor a vehicle proxy!"), *Registered.Name);
+	}
+
+	SolveIfNeeded(Event);
+}
+
+
+void AIntersectionMonitor::OnEntrance(
+	UPrimitiveComponent* OverlappedComp,
+	AActor* OtherActor,
+	UPrimitiveComponent* OtherComp,
+	int32 OtherBodyIndex,
+	bool bFromSweep,
+	const FHitResult& SweepResult)
+{
+	TWeakObjectPtr<UPrimitiveComponent> Trigger(OverlappedComp);
+	TWeakObjectPtr<AActor> Vehicle(OtherActor);
+	if (DeferUntilReady([this, Trigger, Vehicle]() {
+		if (Trigger.IsValid() && Vehicle.IsValid())
+		{
+			OnEntrance(Trigger.Get(), Vehicle.Get(), nullptr, INDEX_NONE, false, FHitResult());
+		}
+	}))
+	{
+		return;
+	}
+	if (!EnterTrigger(OverlappedComp, OtherActor))
+	{
+		return;
+	}
+
+	int32 TimeStep = GetCurrentTimeStep();
+	const FRegisteredVehicle& Registered = VehicleRegistry->Get(TrackVehicle(OtherActor));
+	FString Fork = "f_" + OverlappedComp->GetOwner()->GetName();
+	FMonitorEvent Event("entersForkAtTime", { Registered.Atom, Fork }, TimeStep);
+	AddEvent(Registered.Name, Event);
+	WaitingVehicleLanes.Remove(Registered.Name);
+	SolveIfNeeded(Event);
+}
+
+
+void AIntersectionMonitor::OnEnterLane(AActor* ThisActor, AActor* OtherActor)
+{
+		TWeakObjectPtr<AActor> Lane(ThisActor);
+		TWeakObjectPtr<AActor> Vehicle(OtherActor);
+		if (DeferUntilReady([this, Lane, Vehicle]() {
+			if (Lane.IsValid() && Vehicle.IsValid())
+			{
+				OnEnterLane(Lane.Get(), Vehicle.Get());
+			}
+		}))
+		{
+			return;
+		}
+		if (!IsVehicle(OtherActor))
+		{
+			return;
+		}
+		int32 TimeStep = GetCurrentTimeStep();
+		const FRegisteredVehicle& Registered = VehicleRegistry->Get(TrackVehicle(OtherActor));
+		FString LaneName = "l_" + ThisActor->GetName();
+		FMonitorEvent Event("entersLaneAtTime", { Registered.Atom, LaneName }, TimeStep);
+		AddEvent(Registered.Name, Event);
+		SetOnLane(Registered.Name, LaneName, true);
+		StartTrajectory(OtherActor, Cast<ALane>(ThisActor));
+		SolveIfNeeded(Event);
+}
+
+
+void AIntersectionMonitor::OnExitLane(AActor* ThisActor, AActor* OtherActor)
+{
+		TWeakObjectPtr<AActor> Lane(ThisActor);
+		TWeakObjectPtr<AActor> Vehicle(OtherActor);
+		if (DeferUntilReady([this, Lane, Vehicle]() {
+			if (Lane.IsValid() && Vehicle.IsValid())
+			{
+				OnExitLane(Lane.Get(), Vehicle.Get());
+			}
+		}))
+		{
+			return;
+		}
+		if (!IsVehicle(OtherActor))
+		{
+			return;
+		}
+		int32 TimeStep = GetCurrentTimeStep();
+		const FRegisteredVehicle& Registered = VehicleRegistry->Get(TrackVehicle(OtherActor));
+		FString LaneName = "l_" + ThisActor->GetName();
+		FMonitorEvent Event("leavesLaneAtTime", { Registered.Atom, LaneName }, TimeStep);
+		AddEvent(Registered.Name, Event);
+		SetOnLane(Registered.Name, LaneName, false);
+		SolveIfNeeded(Event);
+}
+
+
+void AIntersectionMonitor::OnExitMonitor(
+	UPrimitiveComponent* OverlappedComp,
+	AActor* OtherActor,
+	UPrimitiveComponent* OtherComp,
+	int32 OtherBodyIndex)
+{
+	TWeakObjectPtr<UPrimitiveComponent> Component(OverlappedComp);
+	TWeakObjectPtr<AActor> Vehicle(OtherActor);
+	if (DeferUntilReady([this, Component, Vehicle]() {
+		if (Component.IsValid() && Vehicle.IsValid())
+		{
+			OnExitMonitor(Component.Get(), Vehicle.Get(), nullptr, INDEX_NONE);
+		}
+	}))
+	{
+		return;
+	}
+	// Wait for the vehicle's last component to leave
+	if (!IsVehicle(OtherActor) || OverlappedComp->IsOverlappingActor(OtherActor))
+	{
+		return;
+	}
+	for (auto It = TriggerOverlapCounts.CreateIterator(); It; ++It)
+	{
+		if (It.Key().Value == OtherActor)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	// Actors without events, e.g. props or pedestrians, never appear in the program
+	int32 VehicleId = VehicleRegistry->Find(OtherActor);
+	FString VehicleName = IsTracking(VehicleId) ? VehicleRegistry->Get(VehicleId).Name : OtherActor->GetName();
+	bool bWasTracked = ActorToEventsMap.Remove(VehicleName) > 0;
+	bool bWasWaiting = WaitingVehicleLanes.Remove(VehicleName) > 0;
+	if (const TBitArray<>* Lanes = VehicleLanes.Find(VehicleName))
+	{
+		for (TConstSetBitIterator<> It(*Lanes); It; ++It)
+		{
+			OccupiedLanes[It.GetIndex()] = --LaneOccupancy[It.GetIndex()] > 0;
+		}
+		VehicleLanes.Remove(VehicleName);
+	}
+	VehicleStates.Remove(VehicleName);
+	if (FVehicleTrajectory* Trajectory = Trajectories.Find(VehicleName))
+	{
+		FinishTrajectory(VehicleName, *Trajectory);
+		Trajectories.Remove(VehicleName);
+	}
+	UntrackVehicle(VehicleId);
+
+	// Only waiting vehicles can be told to yield
+	if (bWasTracked && (bWasWaiting || WaitingVehicleLanes.Num() > 0))
+	{
+		RequestSolve();
+	}
+	else
+	{
+		Statistics.NumSkippedSolves++;
+	}
+}
+
+
+void AIntersectionMonitor::OnLeaveTrigger(
+	UPrimitiveComponent* OverlappedComp,
+	AActor* OtherActor,
+	UPrimitiveComponent* OtherComp,
+	int32 OtherBodyIndex)
+{
+	TWeakObjectPtr<UPrimitiveComponent> Component(OverlappedComp);
+	TWeakObjectPtr<AActor> Vehicle(OtherActor);
+	if (DeferUntilReady([this, Component, Vehicle]() {
+		if (Component.IsValid() && Vehicle.IsValid())
+		{
+			OnLeaveTrigger(Component.Get(), Vehicle.Get(), nullptr, INDEX_NONE);
+		}
+	}))
+	{
+		return;
+	}
+	TPair<const UPrimitiveComponent*, const AActor*> Key(OverlappedComp, OtherActor);
+	int32* Count = TriggerOverlapCounts.Find(Key);
+	if (Count != nullptr && --(*Count) <= 0)
+	{
+		TriggerOverlapCounts.Remove(Key);
+	}
+}
+
+
+bool AIntersectionMonitor::EnterTrigger(const UPrimitiveComponent* Trigger, const AActor* Actor)
+{
+	if (!IsVehicle(Actor))
+	{
+		return false;
+	}
+	// Vehicles with several colliding components overlap a trigger once per component
+	int32& Count = TriggerOverlapCounts.FindOrAdd(TPair<const UPrimitiveComponent*, const AActor*>(Trigger, Actor));
+	return ++Count == 1;
+}
+
+
+bool AIntersectionMonitor::IsVehicle(const AActor* Actor)
+{
+	// Other triggers of the intersection overlap ours too
+	return Actor != nullptr && Actor->IsA<APawn>();
+}
+
+
+void AIntersectionMonitor::SolveIfNeeded(const FMonitorEvent& Event)
+{
+	if (MayAffectDecisions(Event))
+	{
+		RequestSolve();
+	}
+	else
+	{
+		Statistics.NumSkippedSolves++;
+	}
+}
+
+
+bool AIntersectionMonitor::MayAffectDecisions(const FMonitorEvent& Event) const
+{
+	// Predicates outside of the decisions' dependency cone never matter
+	if (!TrafficRules.IsValid())
+	{
+		return false;
+	}
+	if (bHybridState)
+	{
+		bool bMayAffect = false;
+		for (const FString& Predicate : FVehicleStates::GetStatePredicates(Event.Predicate))
+		{
+			bMayAffect = bMayAffect || TrafficRules->MayAffectDecisions(Predicate);
+		}
+		if (!bMayAffect)
+		{
+			return false;
+		}
+	}
+	else if (!TrafficRules->MayAffectDecisions(Event.Predicate))
+	{
+		return false;
+	}
+
+	// Lane occupancy reaches the decisions only through the overlaps of
+	// the lanes wanted by waiting vehicles (yieldToInside).
+	if ((Event.Predicate == "entersLaneAtTime" || Event.Predicate == "leavesLaneAtTime")
+		&& TrafficRules->MayAffectDecisions("overlaps"))
+	{
+		int32 Lane = LaneConflicts.FindLane(Event.Arguments[1]);
+		return Lane == INDEX_NONE || FLaneConflictMatrix::Intersects(LaneConflicts.GetConflicts(Lane), GetWantedLanes());
+	}
+
+	return true;
+}
+
+
+bool AIntersectionMonitor::IsConflictFree() const
+{
+	// Two waiting vehicles always yield one to the other, by arrival order or to the right
+	if (WaitingVehicleLanes.Num() > 1)
+	{
+		return false;
+	}
+	for (auto& Pair : WaitingVehicleLanes)
+	{
+		if (LaneConflicts.AnyConflict(Pair.Value, OccupiedLanes))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+FDecisionSet AIntersectionMonitor::GetConflictFreeDecisions() const
+{
+	FDecisionSet Decisions;
+	for (auto& Pair : ActorToEventsMap)
+	{
+		for (const FMonitorEvent& Event : Pair.Value)
+		{
+			if (Event.Predicate == "arrivesAtForkAtTime")
+			{
+				Decisions.RightOfWay.AddUnique(Event.Arguments[0]);
+			}
+		}
+	}
+	return Decisions;
+}
+
+
+TBitArray<> AIntersectionMonitor::GetWantedLanes() const
+{
+	TBitArray<> WantedLanes = LaneConflicts.MakeLaneSet();
+	for (auto& Pair : WaitingVehicleLanes)
+	{
+		FLaneConflictMatrix::UnionWith(WantedLanes, Pair.Value);
+	}
+	return WantedLanes;
+}
+
+
+void AIntersectionMonitor::SetOnLane(const FString& Vehicle, const FString& Lane, bool bOnLane)
+{
+	int32 LaneIndex = LaneConflicts.FindLane(Lane);
+	if (LaneIndex == INDEX_NONE)
+	{
+		return;
+	}
+	TBitArray<>& Lanes = VehicleLanes.FindOrAdd(Vehicle);
+	if ((LaneIndex < Lanes.Num() && Lanes[LaneIndex]) == bOnLane)
+	{
+		return;
+	}
+	FLaneConflictMatrix::SetLane(Lanes, LaneIndex, bOnLane);
+	LaneOccupancy[LaneIndex] += bOnLane ? 1 : -1;
+	OccupiedLanes[LaneIndex] = LaneOccupancy[LaneIndex] > 0;
+}
+
+
+void AIntersectionMonitor::StartTrajectory(AActor* Vehicle, ALane* Lane)
+{
+	if (!bRecordTrajectories || !Analytics.IsOpen() || Lane == nullptr || Lane->Spline == nullptr
+		|| Trajectories.Contains(Vehicle->GetName()))
+	{
+		return;
+	}
+
+	// Follow the lane the vehicle takes rather than the first one it touches at the fork
+	FString LaneName = "l_" + Lane->GetName();
+	const FVehicleState* State = VehicleStates.Find(Vehicle->GetName());
+	if (State != nullptr && State->WantedLanes.Contains(true))
+	{
+		int32 LaneIndex = LaneConflicts.FindLane(LaneName);
+		if (LaneIndex == INDEX_NONE || LaneIndex >= State->WantedLanes.Num() || !State->WantedLanes[LaneIndex])
+		{
+			return;
+		}
+	}
+
+	FVehicleTrajectory& Trajectory = Trajectories.Add(Vehicle->GetName());
+	Trajectory.Vehicle = Vehicle;
+	Trajectory.Lane = Lane;
+	Trajectory.LaneName = LaneName;
+	Trajectory.Curve = NewObject<UDistanceTimeCurve>(this);
+	SetActorTickEnabled(true);
+}
+
+
+void AIntersectionMonitor::SampleTrajectories()
+{
+	float Time = GetWorld()->GetTimeSeconds();
+	for (auto It = Trajectories.CreateIterator(); It; ++It)
+	{
+		FVehicleTrajectory& Trajectory = It.Value();
+		AActor* Vehicle = Trajectory.Vehicle.Get();
+		if (Vehicle == nullptr || !IsValid(Trajectory.Lane))
+		{
+			// Destroyed inside the extent box, or its lane was
+			FinishTrajectory(It.Key(), Trajectory);
+			It.RemoveCurrent();
+			continue;
+		}
+		USplineComponent* Spline = Trajectory.Lane->Spline;
+		float InputKey = Spline->FindInputKeyClosestToWorldLocation(Vehicle->GetActorLocation());
+		Trajectory.Curve->AddSample(Time, Spline->GetDistanceAlongSplineAtSplineInputKey(InputKey), TrajectoryTolerance);
+	}
+}
+
+
+void AIntersectionMonitor::FinishTrajectory(const FString& Vehicle, FVehicleTrajectory& Trajectory)
+{
+	Trajectory.Curve->FinishSamples();
+	Analytics.AddTrajectory("v_" + Vehicle, Trajectory.LaneName, Trajectory.Curve->GetCurve());
+}
+
+
+void AIntersectionMonitor::RebuildVehicleStates()
+{
+	VehicleStates.Reset();
+	for (auto& Pair : ActorToEventsMap)
+	{
+		for (const FMonitorEvent& Event : Pair.Value)
+		{
+			VehicleStates.Apply(Pair.Key, Event, LaneConflicts, LanesByForkAndSignal);
+		}
+	}
+}
+
+
+void AIntersectionMonitor::RebuildLaneOccupancy()
+{
+	VehicleLanes.Empty();
+	LaneOccupancy.Init(0, LaneConflicts.Num());
+	OccupiedLanes = LaneConflicts.MakeLaneSet();
+	for (auto& Pair : ActorToEventsMap)
+	{
+		for (const FMonitorEvent& Event : Pair.Value)
+		{
+			if (Event.Predicate == "entersLaneAtTime" || Event.Predicate == "leavesLaneAtTime")
+			{
+				SetOnLane(Pair.Key, Event.Arguments[1], Event.Predicate == "entersLaneAtTime");
+			}
+		}
+	}
+}
+
+
+std::string AIntersectionMonitor::GetEventsString() const
+{
+	int32 NumTimeSteps;
+	return GetEventsString(bNormalizeTimeSteps, NumTimeSteps);
+}
+
+
+std::string AIntersectionMonitor::GetEventsString(bool bNormalize, int32& OutNumTimeSteps) const
+{
+	return GetEventsString(ActorToEventsMap, bNormalize, OutNumTimeSteps);
+}
+
+
+std::string AIntersectionMonitor::GetEventsString(const TMap<FString, TArray<FMonitorEvent>>& ActorToEvents, bool bNormalize, int32& OutNumTimeSteps)
+{
+	// Dense ordinal ranks of the live time steps preserve both their order and their equalities
+	TArray<int32> TimeSteps;
+	for (auto& Pair : ActorToEvents)
+	{
+		for (const FMonitorEvent& Event : Pair.Value)
+		{
+			TimeSteps.Add(Event.TimeStep);
+		}
+	}
+	TimeSteps.Sort();
+	TMap<int32, int32> TimeStepRanks;
+	for (int32 TimeStep : TimeSteps)
+	{
+		if (!TimeStepRanks.Contains(TimeStep))
+		{
+			TimeStepRanks.Add(TimeStep, TimeStepRanks.Num());
+		}
+	}
+	OutNumTimeSteps = TimeStepRanks.Num();
+
+	FString EventsString;
+	for (auto& Pair : ActorToEvents)
+	{
+		for (const FMonitorEvent& Event : Pair.Value)
+		{
+			EventsString += Event.ToAtom(bNormalize ? TimeStepRanks[Event.TimeStep] : Event.TimeStep) + "\n";
+		}
+	}
+	return std::string(TCHAR_TO_ANSI(*EventsString));
+}
+
+
+std::string AIntersectionMonitor::GetSolverFacts(const TMap<FString, TArray<FMonitorEvent>>& ActorToEvents, bool bNormalize, int32& OutNumTimeSteps) const
+{
+	if (!bHybridState)
+	{
+		return GetEventsString(ActorToEvents, bNormalize, OutNumTimeSteps);
+	}
+	TArray<FString> Vehicles;
+	ActorToEvents.GetKeys(Vehicles);
+	return VehicleStates.GetFacts(Vehicles, LaneConflicts, bNormalize, OutNumTimeSteps);
+}
+
+
+void AIntersectionMonitor::RequestSolve()
+{
+	// Solves of all monitors share a per-frame budget
+	UMonitorScheduler* Scheduler = GetWorld()->GetSubsystem<UMonitorScheduler>();
+	if (Scheduler != nullptr)
+	{
+		Scheduler->RequestSolve(this);
+	}
+	else
+	{
+		Solve();
+	}
+}
+
+
+void AIntersectionMonitor::RunScheduledSolve()
+{
+	Solve();
+}
+
+
+int32 AIntersectionMonitor::GetSolvePriority() const
+{
+	if (WaitingVehicleLanes.Num() > 0)
+	{
+		return 2;
+	}
+	return ActorToEventsMap.Num() > 0 ? 1 : 0;
+}
+
+
+void AIntersectionMonitor::Solve()
+{
+	if (!TrafficRules.IsValid())
+	{
+		return;
+	}
+	double StartTime = FPlatformTime::Seconds();
+
+	if (bSkipConflictFreeSolves && IsConflictFree())
+	{
+		FDecisionSet Decisions = GetConflictFreeDecisions();
+		Statistics.NumConflictFreeSolves++;
+		Analytics.AddSolve(GetWorld()->GetTimeSeconds(), EAnalyticsSolve::ConflictFree, ActorToEventsMap.Num(), 0, 0, FPlatformTime::Seconds() - StartTime);
+		if (ShadowEvaluator.IsValid())
+		{
+			int32 NumTimeSteps;
+			ShadowEvaluator->Submit(GetSolverFacts(ActorToEventsMap, bNormalizeTimeSteps, NumTimeSteps) + Geometry, Decisions);
+		}
+		ApplyDecisions(Decisions);
+		return;
+	}
+
+	if (bPartitionConflictComponents && !bUseSolverService)
+	{
+		TArray<TArray<FString>> Components = GetConflictComponents();
+		if (Components.Num() > 1)
+		{
+			SolveComponents(Components);
+			return;
+		}
+	}
+
+	// The canonical form drops absolute times, which is only sound when they are normalized anyway
+	bool bCacheDecisions = bUseDecisionCache && bNormalizeTimeSteps;
+	FString CacheKey;
+	TArray<FString> CanonicalVehicles;
+	FDecisionSet Decisions;
+	if (bCacheDecisions)
+	{
+		CacheKey = DecisionCache.Canonicalize(ActorToEventsMap, CanonicalVehicles);
+		Statistics.NumCacheLookups++;
+		if (DecisionCache.Find(CacheKey, CanonicalVehicles, Decisions))
+		{
+			Statistics.NumCacheHits++;
+			Analytics.AddSolve(GetWorld()->GetTimeSeconds(), EAnalyticsSolve::CacheHit, ActorToEventsMap.Num(), 0, 0, FPlatformTime::Seconds() - StartTime);
+			if (ShadowEvaluator.IsValid())
+			{
+				int32 NumTimeSteps;
+				ShadowEvaluator->Submit(GetSolverFacts(ActorToEventsMap, bNormalizeTimeSteps, NumTimeSteps) + Geometry, Decisions);
+			}
+			ApplyDecisions(Decisions);
+			return;
+		}
+	}
+
+	int32 NumTimeSteps;
+	std::string Program = GetSolverFacts(ActorToEventsMap, bNormalizeTimeSteps, NumTimeSteps) + Geometry;
+
+	if (bUseSolverService)
+	{
+		if (SubmitToSolverService(Program, NumTimeSteps, CacheKey, CanonicalVehicles))
+		{
+			return;
+		}
+		Statistics.NumServiceFallbacks++;
+	}
+
+	if (!ComputeDecisions(Program, NumTimeSteps, Decisions))
+	{
+		return;
+	}
+	CacheAndApplyDecisions(CacheKey, CanonicalVehicles, Program, Decisions);
+}
+
+
+TArray<TArray<FString>> AIntersectionMonitor::GetConflictComponents() const
+{
+	TArray<FString> Vehicles;
+	ActorToEventsMap.GetKeys(Vehicles);
+
+	// Union-find over the vehicles
+	TArray<int32> Parents;
+	for (int32 i = 0; i < Vehicles.Num(); i++)
+	{
+		Parents.Add(i);
+	}
+	auto FindRoot = [&Parents](int32 i) {
+		while (Parents[i] != i)
+		{
+			Parents[i] = Parents[Parents[i]];
+			i = Parents[i];
+		}
+		return i;
+	};
+	auto Union = [&Parents, &FindRoot](int32 i, int32 j) {
+		Parents[FindRoot(i)] = FindRoot(j);
+	};
+
+	TArray<FString> Forks;
+	Forks.SetNum(Vehicles.Num());
+	for (int32 i = 0; i < Vehicles.Num(); i++)
+	{
+		for (const FMonitorEvent& Event : ActorToEventsMap[Vehicles[i]])
+		{
+			if (Event.Predicate == "arrivesAtForkAtTime")
+			{
+				Forks[i] = Event.Arguments[1];
+			}
+		}
+	}
+
+	// Unless every yield rule needs a lane or fork conflict, any two waiting vehicles may yield to each other
+	bool bYieldOnlyOnConflicts = TrafficRules->YieldsOnlyOnConflicts();
+	TBitArray<> NoLanes;
+	int32 FirstWaiting = INDEX_NONE;
+	for (int32 i = 0; i < Vehicles.Num(); i++)
+	{
+		// Only waiting vehicles are told to yield, to the vehicles they conflict with
+		const TBitArray<>* WantedLanes = WaitingVehicleLanes.Find(Vehicles[i]);
+		if (WantedLanes == nullptr)
+		{
+			continue;
+		}
+		if (!bYieldOnlyOnConflicts)
+		{
+			if (FirstWaiting != INDEX_NONE)
+			{
+				Union(i, FirstWaiting);
+			}
+			FirstWaiting = i;
+		}
+		for (int32 j = 0; j < Vehicles.Num(); j++)
+		{
+			if (j == i)
+			{
+				continue;
+			}
+			const TBitArray<>* OtherLanes = VehicleLanes.Find(Vehicles[j]);
+			if (LaneConflicts.AnyConflict(*WantedLanes, OtherLanes != nullptr ? *OtherLanes : NoLanes))
+			{
+				Union(i, j);
+				continue;
+			}
+			const TBitArray<>* OtherWantedLanes = WaitingVehicleLanes.Find(Vehicles[j]);
+			if (OtherWantedLanes != nullptr
+				&& (AdjacentForks.Contains(TPair<FString, FString>(Forks[i], Forks[j]))
+					|| LaneConflicts.AnyConflict(*WantedLanes, *OtherWantedLanes)))
+			{
+				Union(i, j);
+			}
+		}
+	}
+
+	TMap<int32, TArray<FString>> ComponentsByRoot;
+	for (int32 i = 0; i < Vehicles.Num(); i++)
+	{
+		ComponentsByRoot.FindOrAdd(FindRoot(i)).Add(Vehicles[i]);
+	}
+	TArray<TArray<FString>> Components;
+	ComponentsByRoot.GenerateValueArray(Components);
+	return Components;
+}
+
+
+void AIntersectionMonitor::SolveComponents(const TArray<TArray<FString>>& Components)
+{
+	struct FComponentSolve
+	{
+		TMap<FString, TArray<FMonitorEvent>> Events;
+		FString CacheKey;
+		TArray<FString> CanonicalVehicles;
+		std::string Program;
+		int32 NumTimeSteps = 0;
+		FDecisionSet Decisions;
+		bool bCached = false;
+		bool bSolved = false;
+		size_t NumGroundAtoms = 0;
+		double Seconds = 0.0;
+	};
+
+	// Cache lookups on the game thread, solves of the misses on all cores
+	bool bCacheDecisions = bUseDecisionCache && bNormalizeTimeSteps;
+	TArray<FComponentSolve> Solves;
+	Solves.SetNum(Components.Num());
+	for (int32 i = 0; i < Components.Num(); i++)
+	{
+		FComponentSolve& Component = Solves[i];
+		for (const FString& Vehicle : Components[i])
+		{
+			Component.Events.Add(Vehicle, ActorToEventsMap[Vehicle]);
+		}
+		Component.Program = GetSolverFacts(Component.Events, bNormalizeTimeSteps, Component.NumTimeSteps) + Geometry;
+		if (bCacheDecisions)
+		{
+			Component.CacheKey = DecisionCache.Canonicalize(Component.Events, Component.CanonicalVehicles);
+			Statistics.NumCacheLookups++;
+			Component.bCached = DecisionCache.Find(Component.CacheKey, Component.CanonicalVehicles, Component.Decisions);
+			Statistics.NumCacheHits += Component.bCached ? 1 : 0;
+		}
+	}
+	const FTrafficRules& Rules = *TrafficRules;
+	ParallelFor(Solves.Num(), [&Solves, &Rules](int32 i) {
+		FComponentSolve& Component = Solves[i];
+		if (!Component.bCached)
+		{
+			double StartTime = FPlatformTime::Seconds();
+			Component.bSolved = Rules.Solve(Component.Program, Component.Decisions, &Component.NumGroundAtoms);
+			Component.Seconds = FPlatformTime::Seconds() - StartTime;
+		}
+	});
+
+	FDecisionSet Decisions;
+	bool bSatisfiable = true;
+	for (FComponentSolve& Component : Solves)
+	{
+		if (!Component.bCached)
+		{
+			if (!Component.bSolved)
+			{
+				bSatisfiable = false;
+				continue;
+			}
+			Statistics.NumSolves++;
+			Statistics.SumTimeSteps += Component.NumTimeSteps;
+			Statistics.SumGroundAtoms += Component.NumGroundAtoms;
+			Analytics.AddSolve(GetWorld()->GetTimeSeconds(), EAnalyticsSolve::Component, Component.Events.Num(),
+				Component.NumTimeSteps, Component.NumGroundAtoms, Component.Seconds);
+			if (!Component.CacheKey.IsEmpty())
+			{
+				DecisionCache.Add(Component.CacheKey, Component.CanonicalVehicles, Component.Decisions);
+			}
+		}
+		Decisions.MustYield.Append(Component.Decisions.MustYield);
+		Decisions.RightOfWay.Append(Component.Decisions.RightOfWay);
+	}
+	Statistics.NumPartitionedSolves++;
+	Statistics.SumComponents += Solves.Num();
+
+	// Keep the previous decisions, as when the whole program is unsatisfiable
+	if (bSatisfiable)
+	{
+		// The shadow rules may couple the vehicles differently, so they get the whole program
+		if (ShadowEvaluator.IsValid())
+		{
+			int32 NumTimeSteps;
+			ShadowEvaluator->Submit(GetSolverFacts(ActorToEventsMap, bNormalizeTimeSteps, NumTimeSteps) + Geometry, Decisions);
+		}
+		ApplyDecisions(Decisions);
+	}
+}
+
+
+void AIntersectionMonitor::CacheAndApplyDecisions(const FString& CacheKey, const TArray<FString>& CanonicalVehicles, const std::string& Program, const FDecisionSet& Decisions)
+{
+	if (!CacheKey.IsEmpty())
+	{
+		DecisionCache.Add(CacheKey, CanonicalVehicles, Decisions);
+	}
+	if (ShadowEvaluator.IsValid())
+	{
+		ShadowEvaluator->Submit(Program, Decisions);
+	}
+	ApplyDecisions(Decisions);
+}
+
+
+void AIntersectionMonitor::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!bReady)
+	{
+		if (!Startup.IsReady())
+		{
+			return;
+		}
+		FinishStartup(Startup.Get());
+		Startup = TFuture<FMonitorStartup>();
+	}
+
+	PollSolverService();
+	SampleTrajectories();
+}
+
+
+bool AIntersectionMonitor::SubmitToSolverService(const std::string& Program, int32 NumTimeSteps, const FString& CacheKey, const TArray<FString>& CanonicalVehicles)
+{
+	uint64 Ticket;
+	if (!FSolverServiceClient::Get().Submit(TrafficRules->GetFileFullName(), Program, Ticket))
+	{
+		return false;
+	}
+
+	Statistics.NumServiceSolves++;
+	ServiceTickets.Add(Ticket);
+	ServiceCacheKey = CacheKey;
+	ServiceCanonicalVehicles = CanonicalVehicles;
+	ServiceProgram = Program;
+	ServiceNumTimeSteps = NumTimeSteps;
+	ServiceSubmitTime = FPlatformTime::Seconds();
+	SetActorTickEnabled(true);
+	return true;
+}
+
+
+void AIntersectionMonitor::PollSolverService()
+{
+	FSolverServiceClient& Service = FSolverServiceClient::Get();
+	for (int32 i = 0; i < ServiceTickets.Num(); i++)
+	{
+		bool bNewest = i == ServiceTickets.Num() - 1;
+		FDecisionSet Decisions;
+		FSolverServiceClient::EPollResult Result = Service.Poll(ServiceTickets[i], Decisions);
+		if (Result == FSolverServiceClient::EPollResult::Pending)
+		{
+			continue;
+		}
+		ServiceTickets.RemoveAt(i--);
+
+		// Older results are superseded by the newest request
+		if (!bNewest)
+		{
+			continue;
+		}
+		if (Result == FSolverServiceClient::EPollResult::Done)
+		{
+			Analytics.AddSolve(GetWorld()->GetTimeSeconds(), EAnalyticsSolve::Service, ServiceCanonicalVehicles.Num(),
+				ServiceNumTimeSteps, 0, FPlatformTime::Seconds() - ServiceSubmitTime);
+			CacheAndApplyDecisions(ServiceCacheKey, ServiceCanonicalVehicles, ServiceProgram, Decisions);
+		}
+		else
+		{
+			// Solve the same events the service was given
+			Statistics.NumServiceFallbacks++;
+			if (ComputeDecisions(ServiceProgram, ServiceNumTimeSteps, Decisions))
+			{
+				CacheAndApplyDecisions(ServiceCacheKey, ServiceCanonicalVehicles, ServiceProgram, Decisions);
+			}
+		}
+	}
+
+	if (ServiceTickets.Num() == 0 && Trajectories.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+
+bool AIntersectionMonitor::ComputeDecisions(const std::string& Program, int32 NumTimeSteps, FDecisionSet& OutDecisions)
+{
+	size_t NumGroundAtoms = 0;
+	double StartTime = FPlatformTime::Seconds();
+	if (!TrafficRules->Solve(Program, OutDecisions, &NumGroundAtoms))
+	{
+		return false;
+	}
+	Analytics.AddSolve(GetWorld()->GetTimeSeconds(), EAnalyticsSolve::InProcess, ActorToEventsMap.Num(),
+		NumTimeSteps, NumGroundAtoms, FPlatformTime::Seconds() - StartTime);
+
+	Statistics.NumSolves++;
+	Statistics.SumTimeSteps += NumTimeSteps;
+	Statistics.SumGroundAtoms += NumGroundAtoms;
+	if (bMeasureTimeNormalization && bNormalizeTimeSteps)
+	{
+		int32 NumRawTimeSteps;
+		std::string RawEventsString = GetSolverFacts(ActorToEventsMap, false, NumRawTimeSteps);
+		Statistics.NumMeasuredSolves++;
+		Statistics.SumMeasuredGroundAtoms += NumGroundAtoms;
+		Statistics.SumRawGroundAtoms += CountGroundAtoms(RawEventsString);
+	}
+	if (Statistics.NumSolves % 100 == 0)
+	{
+		LogStatistics();
+	}
+
+	UE_LOG(LogTemp, Verbose, TEXT("%s decided %d yields and %d rights of way."),
+		*GetName(), OutDecisions.MustYield.Num(), OutDecisions.RightOfWay.Num());
+	return true;
+}
+
+
+void AIntersectionMonitor::ApplyDecisions(const FDecisionSet& Decisions)
+{
+	Analytics.AddDecisions(GetWorld()->GetTimeSeconds(), Decisions);
+	DecisionSnapshot.Publish(Decisions, GetCurrentTimeStep());
+	LastDecisions = Decisions;
+
+	// Vehicles destroyed since the events were solved are not in the registry anymore
+	for (const FYieldDecision& Decision : Decisions.MustYield)
+	{
+		int32 VehicleId = VehicleRegistry->FindByAtom(Decision.Vehicle);
+		if (IsTracking(VehicleId) && VehicleRegistry->SetMayProceed(VehicleId, false))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Setting %s's controller to yield!"), *Decision.Vehicle.RightChop(2));
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s's controller not found! (mustYield)"), *Decision.Vehicle.RightChop(2));
+		}
+	}
+	for (const FString& RightOfWay : Decisions.RightOfWay)
+	{
+		int32 VehicleId = VehicleRegistry->FindByAtom(RightOfWay);
+		if (!IsTracking(VehicleId) || !VehicleRegistry->SetMayProceed(VehicleId, true))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s's controller not found! (hasRightOfWay)"), *RightOfWay.RightChop(2));
+		}
+	}
+}
+
+
+int32 AIntersectionMonitor::TrackVehicle(AActor* Vehicle)
+{
+	int32 VehicleId = VehicleRegistry->Find(Vehicle);
+	if (IsTracking(VehicleId))
+	{
+		return VehicleId;
+	}
+	VehicleId = VehicleRegistry->Acquire(Vehicle);
+	if (VehicleId >= TrackedVehicles.Num())
+	{
+		TrackedVehicles.Add(false, VehicleId + 1 - TrackedVehicles.Num());
+	}
+	TrackedVehicles[VehicleId] = true;
+	return VehicleId;
+}
+
+
+void AIntersectionMonitor::UntrackVehicle(int32 VehicleId)
+{
+	if (IsTracking(VehicleId))
+	{
+		TrackedVehicles[VehicleId] = false;
+		VehicleRegistry->Release(VehicleId);
+	}
+}
+
+
+bool AIntersectionMonitor::IsTracking(int32 VehicleId) const
+{
+	return VehicleId != INDEX_NONE && VehicleId < TrackedVehicles.Num() && TrackedVehicles[VehicleId];
+}
+
+
+float AIntersectionMonitor::GetDecisionCacheHitRate() const
+{
+	return Statistics.NumCacheLookups > 0 ? float(Statistics.NumCacheHits) / Statistics.NumCacheLookups : 0.f;
+}
+
+
+int32 AIntersectionMonitor::GetCurrentTimeStep() const
+{
+	if (ReplayTimeStep != INDEX_NONE)
+	{
+		return ReplayTimeStep;
+	}
+	return FMath::FloorToInt(GetWorld()->GetTimeSeconds() / TimeResolution);
+}
+
+
+namespace
+{
+	constexpr uint32 CheckpointMagic = 0x4D434B50; // "MCKP"
+	constexpr uint32 CheckpointVersion = 3;
+}
+
+
+void AIntersectionMonitor::SaveCheckpoint(TArray<uint8>& OutData) const
+{
+	FMemoryWriter Writer(OutData);
+	uint32 Magic = CheckpointMagic;
+	uint32 Version = CheckpointVersion;
+	FString GeometryString(UTF8_TO_TCHAR(Geometry.c_str()));
+	int32 TimeStep = GetCurrentTimeStep();
+	Writer << Magic << Version << GeometryString << TimeStep;
+
+	// Vehicles by name, to be found again in the world
+	TMap<FString, TArray<FMonitorEvent>> Events = ActorToEventsMap;
+	TMap<FString, TBitArray<>> WaitingLanes = WaitingVehicleLanes;
+	TArray<FString> Vehicles;
+	for (TConstSetBitIterator<> It(TrackedVehicles); It; ++It)
+	{
+		Vehicles.Add(VehicleRegistry->Get(It.GetIndex()).Name);
+	}
+	FDecisionSet Decisions = LastDecisions;
+	FSolveStatistics SavedStatistics = Statistics;
+	Writer << Events << WaitingLanes << Vehicles << Decisions << SavedStatistics;
+}
+
+
+bool AIntersectionMonitor::RestoreCheckpoint(const TArray<uint8>& Data)
+{
+	if (!bReady)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s: cannot restore a checkpoint before the monitor is ready!"), *GetName());
+		return false;
+	}
+	FMemoryReader Reader(Data);
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	FString GeometryString;
+	int32 CheckpointTimeStep = 0;
+	Reader << Magic << Version;
+	if (Magic != CheckpointMagic || Version != CheckpointVersion)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s: not a monitor checkpoint, or of another version!"), *GetName());
+		return false;
+	}
+	Reader << GeometryString << CheckpointTimeStep;
+	if (GeometryString != FString(UTF8_TO_TCHAR(Geometry.c_str())))
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s: the checkpoint is of an intersection with another geometry!"), *GetName());
+		return false;
+	}
+
+	TMap<FString, TArray<FMonitorEvent>> Events;
+	TMap<FString, TBitArray<>> WaitingLanes;
+	TArray<FString> Vehicles;
+	FDecisionSet Decisions;
+	FSolveStatistics RestoredStatistics;
+	Reader << Events << WaitingLanes << Vehicles << Decisions << RestoredStatistics;
+	if (Reader.IsError())
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s: the checkpoint is truncated!"), *GetName());
+		return false;
+	}
+
+	// Drop whatever is in flight for the current state
+	if (UMonitorScheduler* Scheduler = GetWorld()->GetSubsystem<UMonitorScheduler>())
+	{
+		Scheduler->CancelSolve(this);
+	}
+	for (uint64 Ticket : ServiceTickets)
+	{
+		FSolverServiceClient::Get().Discard(Ticket);
+	}
+	ServiceTickets.Empty();
+
+	// Keep the events in the past of the events to come
+	int32 TimeShift = GetCurrentTimeStep() - CheckpointTimeStep;
+	for (auto& ActorAndEvents : Events)
+	{
+		for (FMonitorEvent& Event : ActorAndEvents.Value)
+		{
+			Event.TimeStep += TimeShift;
+		}
+	}
+	ActorToEventsMap = MoveTemp(Events);
+	WaitingVehicleLanes = MoveTemp(WaitingLanes);
+	Statistics = RestoredStatistics;
+
+	for (TConstSetBitIterator<> It(TrackedVehicles); It; ++It)
+	{
+		VehicleRegistry->Release(It.GetIndex());
+	}
+	TrackedVehicles.Empty();
+	TArray<FString> VehiclesWithEvents;
+	ActorToEventsMap.GetKeys(VehiclesWithEvents);
+	for (const FString& Vehicle : VehiclesWithEvents)
+	{
+		Vehicles.AddUnique(Vehicle);
+	}
+	// No exit would ever remove a vehicle that is not in the world, and it would keep the others yielding
+	int32 NumMissing = 0;
+	for (const FString& Vehicle : Vehicles)
+	{
+		AActor* Actor = FindObject<AActor>(GetWorld()->PersistentLevel, *Vehicle);
+		if (Actor != nullptr)
+		{
+			TrackVehicle(Actor);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s: vehicle %s of the checkpoint is not in the world, dropping it."), *GetName(), *Vehicle);
+			ActorToEventsMap.Remove(Vehicle);
+			WaitingVehicleLanes.Remove(Vehicle);
+			NumMissing++;
+		}
+	}
+	RecountTriggerOverlaps();
+	RebuildLaneOccupancy();
+	RebuildVehicleStates();
+
+	for (auto It = Trajectories.CreateIterator(); It; ++It)
+	{
+		if (!ActorToEventsMap.Contains(It.Key()))
+		{
+			FinishTrajectory(It.Key(), It.Value());
+			It.RemoveCurrent();
+		}
+	}
+	SetActorTickEnabled(Trajectories.Num() > 0);
+
+	// The checkpoint's decisions may make the others yield to the dropped vehicles
+	if (NumMissing > 0)
+	{
+		RequestSolve();
+	}
+	else
+	{
+		ApplyDecisions(Decisions);
+	}
+	UE_LOG(LogTemp, Log, TEXT("%s: restored %d vehicles from a checkpoint."), *GetName(), ActorToEventsMap.Num());
+	return true;
+}
+
+
+void AIntersectionMonitor::RecountTriggerOverlaps()
+{
+	TriggerOverlapCounts.Empty();
+	for (UPrimitiveComponent* Trigger : ForkTriggers)
+	{
+		TArray<UPrimitiveComponent*> OverlappingComponents;
+		Trigger->GetOverlappingComponents(OverlappingComponents);
+		for (UPrimitiveComponent* Component : OverlappingComponents)
+		{
+			if (IsVehicle(Component->GetOwner()))
+			{
+				TriggerOverlapCounts.FindOrAdd(TPair<const UPrimitiveComponent*, const AActor*>(Trigger, Component->GetOwner()))++;
+			}
+		}
+	}
+}
+
+
+bool AIntersectionMonitor::SaveCheckpointToFile(const FString& FileName) const
+{
+	TArray<uint8> Data;
+	SaveCheckpoint(Data);
+	return FFileHelper::SaveArrayToFile(Data, *(FPaths::ProjectSavedDir() + FileName));
+}
+
+
+bool AIntersectionMonitor::RestoreCheckpointFromFile(const FString& FileName)
+{
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *(FPaths::ProjectSavedDir() + FileName)))
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s: cannot read the checkpoint %s!"), *GetName(), *FileName);
+		return false;
+	}
+	return RestoreCheckpoint(Data);
+}
+
+
+bool AIntersectionMonitor::GetVehicleDecision(FName Vehicle, bool& bOutHasRightOfWay, FName& OutYieldsTo, FName& OutRule) const
+{
+	FDecisionSnapshot Snapshot = DecisionSnapshot.Read();
+	const FVehicleDecision* Decision = Snapshot.Find(Vehicle);
+	if (Decision == nullptr)
+	{
+		return false;
+	}
+	bOutHasRightOfWay = Decision->bHasRightOfWay;
+	OutYieldsTo = Decision->YieldsTo;
+	OutRule = Decision->Rule;
+	return true;
+}
+
+
+size_t AIntersectionMonitor::CountGroundAtoms(const std::string& EventsString) const
+{
+	Clingo::Control ctl{ {}, [](Clingo::WarningCode, char const *) {}, 20 };
+	ctl.add("base", {}, EventsString.c_str());
+	ctl.add("base", {}, Geometry.c_str());
+	TrafficRules->AddToControl(ctl);
+	ctl.ground({ {"base", {}} });
+	return ctl.symbolic_atoms().size();
+}
+
+
+void AIntersectionMonitor::LogStatistics() const
+{
+	if (Statistics.NumSolves == 0 && Statistics.NumCacheLookups == 0 && Statistics.NumConflictFreeSolves == 0)
+	{
+		return;
+	}
+	UE_LOG(LogTemp, Log, TEXT("%s: %lld solves (%lld skipped, %lld conflict-free), %.1f time steps and %.1f ground atoms per solve."),
+		*GetName(),
+		Statistics.NumSolves,
+		Statistics.NumSkippedSolves,
+		Statistics.NumConflictFreeSolves,
+		double(Statistics.SumTimeSteps) / FMath::Max<int64>(Statistics.NumSolves, 1),
+		double(Statistics.SumGroundAtoms) / FMath::Max<int64>(Statistics.NumSolves, 1));
+	if (Statistics.NumMeasuredSolves > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("%s: time normalization grounds %.1f%% of the atoms grounded with raw time steps."),
+			*GetName(),
+			100.0 * Statistics.SumMeasuredGroundAtoms / FMath::Max<int64>(Statistics.SumRawGroundAtoms, 1));
+	}
+	if (Statistics.NumServiceSolves > 0 || Statistics.NumServiceFallbacks > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("%s: %lld solves sent to the solver service, %lld solved in-process instead."),
+			*GetName(),
+			Statistics.NumServiceSolves,
+			Statistics.NumServiceFallbacks);
+	}
+	if (Statistics.NumPartitionedSolves > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("%s: %lld solves split into %.1f independent conflict components on average."),
+			*GetName(),
+			Statistics.NumPartitionedSolves,
+			double(Statistics.SumComponents) / Statistics.NumPartitionedSolves);
+	}
+	if (Statistics.NumCacheLookups > 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("%s: decision cache hit rate %.1f%% (%lld of %lld, %d symmetries)."),
+			*GetName(),
+			100.f * GetDecisionCacheHitRate(),
+			Statistics.NumCacheHits,
+			Statistics.NumCacheLookups,
+			DecisionCache.NumSymmetries());
+	}
+}
+
+
 template <class ActorClass>
 void AIntersectionMonitor::GetIntersectingActors(TArray<ActorClass*>& OutArray)
 {
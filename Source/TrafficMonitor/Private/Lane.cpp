@@ -4,6 +4,8 @@
 #include "Lane.h"
 #include "Runtime/CoreUObject/Public/UObject/ConstructorHelpers.h"
 #include "Fork.h"
+#include "TriggerCollision.h"
+#include "Async/ParallelFor.h"
 
 
 
@@ -37,20 +39,31 @@ void ALane::OnConstruction(const FTransform &Transform)
 	UE_LOG(LogTemp, Warning, TEXT("ALane OnConstruction called!"));
 }
 
+#if WITH_EDITOR
+void ALane::PostEditMove(bool bFinished)
+{
+	Super::PostEditMove(bFinished);
+
+	if (bFinished)
+	{
+		AIntersectionMonitor::NotifyGeometryChanged(this);
+	}
+}
+#endif // WITH_EDITOR
+
 void ALane::Init(AFork* MyFork, AExit* MyExit)
 {
 	this->MyFork = MyFork;
 	this->MyExit = MyExit;
-	
-	SetupSpline();
-	SetupSplineMeshes();
 }
 
 FString ALane::GetCorrectSignal()
 {
-	auto EntranceDirection = MyFork->GetActorForwardVector();
-	auto ExitDirection = MyExit->GetActorForwardVector();
+	return GetCorrectSignal(MyFork->GetActorForwardVector(), MyExit->GetActorForwardVector());
+}
 
+FString ALane::GetCorrectSignal(const FVector& EntranceDirection, const FVector& ExitDirection)
+{
 	float Z = FVector::CrossProduct(EntranceDirection, ExitDirection).Z;
 	auto Cosine = EntranceDirection.CosineAngle2D(FVector::VectorPlaneProject(ExitDirection, FVector(0.f, 0.f, 1.f)));
 
@@ -78,23 +91,35 @@ FString ALane::GetCorrectSignal()
 	}
 }
 
-void ALane::SetupSpline()
+FLaneEndpoints ALane::GetEndpoints() const
+{
+	FLaneEndpoints Endpoints;
+	Endpoints.LaneTransform = Spline->GetComponentTransform();
+	Endpoints.EntranceLocation = MyFork->GetActorLocation();
+	Endpoints.EntranceDirection = MyFork->GetActorForwardVector();
+	Endpoints.EntranceWidth = MyFork->EntranceTriggerVolume->GetScaledBoxExtent().Y;
+	Endpoints.ExitLocation = MyExit->GetActorLocation();
+	Endpoints.ExitDirection = MyExit->GetActorForwardVector();
+	Endpoints.ExitWidth = MyExit->TriggerVolume->GetScaledBoxExtent().Y;
+	Endpoints.MaxMeshLength = MaxMeshLength;
+	return Endpoints;
+}
+
+
+FLaneGeometry ALane::ComputeGeometry(const FLaneEndpoints& Endpoints)
 {
-	FVector EntranceLocation = MyFork->GetActorLocation();
-	FVector EntranceDirection = MyFork->GetActorForwardVector();
-	FVector ExitLocation = MyExit->GetActorLocation();
-	FVector ExitDirection = MyExit->GetActorForwardVector();
-
-	Spline->SetLocationAtSplinePoint(0, EntranceLocation, ESplineCoordinateSpace::World);
-	Spline->SetLocationAtSplinePoint(1, ExitLocation, ESplineCoordinateSpace::World);
-
-	FVector2D p0 = FVector2D(EntranceLocation.X, EntranceLocation.Y);
-	FVector2D p1 = FVector2D(ExitLocation.X, ExitLocation.Y);
-	FVector2D d0 = FVector2D(EntranceDirection.X, EntranceDirection.Y);
-	FVector2D d1 = FVector2D(ExitDirection.X, ExitDirection.Y);
+	FLaneGeometry Geometry;
+	const FTransform& Transform = Endpoints.LaneTransform;
+
+	// Spline with user tangents if a curvature variation minimizing interpolant exists, automatic ones otherwise
+	FVector2D p0 = FVector2D(Endpoints.EntranceLocation.X, Endpoints.EntranceLocation.Y);
+	FVector2D p1 = FVector2D(Endpoints.ExitLocation.X, Endpoints.ExitLocation.Y);
+	FVector2D d0 = FVector2D(Endpoints.EntranceDirection.X, Endpoints.EntranceDirection.Y);
+	FVector2D d1 = FVector2D(Endpoints.ExitDirection.X, Endpoints.ExitDirection.Y);
 	float Alpha0 = 1.f;
 	float Alpha1 = 1.f;
-	float TurnAngleCosine = EntranceDirection.CosineAngle2D(ExitDirection);
+	bool bFitted = false;
+	float TurnAngleCosine = Endpoints.EntranceDirection.CosineAngle2D(Endpoints.ExitDirection);
 	if (TurnAngleCosine < -0.8f)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("Need to make a U-turn!"));
@@ -102,18 +127,60 @@ void ALane::SetupSpline()
 	}
 	else if (MinimumCurvatureVariation(p0, p1, d0, d1, Alpha0, Alpha1))
 	{
-		Spline->SetTangentAtSplinePoint(0, EntranceDirection*Alpha0, ESplineCoordinateSpace::World);
-		Spline->SetTangentAtSplinePoint(1, ExitDirection*Alpha1, ESplineCoordinateSpace::World);
+		bFitted = true;
 	}
 	else // Need an inflection point
 	{
 		UE_LOG(LogTemp, Warning, TEXT("Need an inflection point!"));
 	}
 
+	FVector EntranceTangent = Transform.InverseTransformVector(Endpoints.EntranceDirection*Alpha0);
+	FVector ExitTangent = Transform.InverseTransformVector(Endpoints.ExitDirection*Alpha1);
+	EInterpCurveMode Mode = bFitted ? CIM_CurveUser : CIM_CurveAuto;
+	FSplineCurves& Curves = Geometry.SplineCurves;
+	Curves.Position.Points.Emplace(0.f, Transform.InverseTransformPosition(Endpoints.EntranceLocation), EntranceTangent, EntranceTangent, Mode);
+	Curves.Position.Points.Emplace(1.f, Transform.InverseTransformPosition(Endpoints.ExitLocation), ExitTangent, ExitTangent, Mode);
+	Curves.Rotation.Points.Emplace(0.f, FQuat::Identity, FQuat::Identity, FQuat::Identity, CIM_CurveAuto);
+	Curves.Rotation.Points.Emplace(1.f, FQuat::Identity, FQuat::Identity, FQuat::Identity, CIM_CurveAuto);
+	Curves.Scale.Points.Emplace(0.f, FVector(1.f), FVector::ZeroVector, FVector::ZeroVector, CIM_CurveAuto);
+	Curves.Scale.Points.Emplace(1.f, FVector(1.f), FVector::ZeroVector, FVector::ZeroVector, CIM_CurveAuto);
+	Curves.UpdateSpline(false, false, 10, false, 0.f, Transform.GetScale3D());
+
+	// Mesh segments, sampled the way USplineComponent does at distances along the spline
+	float SplineLength = Curves.GetSplineLength();
+	float MaxMeshLengthCM = 100.f*Endpoints.MaxMeshLength;
+	int NumberOfMeshes = FMath::Max(1, FMath::CeilToInt(SplineLength / MaxMeshLengthCM));
+	float MeshLength = SplineLength / NumberOfMeshes;
+	float WidthChange = Endpoints.ExitWidth - Endpoints.EntranceWidth;
+
+	auto LocationAt = [&Curves](float Distance) {
+		return Curves.Position.Eval(Curves.ReparamTable.Eval(Distance, 0.f), FVector::ZeroVector);
+	};
+	auto DirectionAt = [&Curves](float Distance) {
+		return Curves.Position.EvalDerivative(Curves.ReparamTable.Eval(Distance, 0.f), FVector::ZeroVector).GetSafeNormal();
+	};
+
+	Geometry.Segments.Reserve(NumberOfMeshes);
+	for (int MeshIndex = 0; MeshIndex < NumberOfMeshes; MeshIndex++)
+	{
+		FLaneSegment Segment;
+		Segment.StartPosition = LocationAt(MeshIndex*MeshLength);
+		Segment.EndPosition = LocationAt((MeshIndex + 1)*MeshLength);
+		Segment.StartDirection = DirectionAt(MeshIndex*MeshLength);
+		Segment.EndDirection = DirectionAt((MeshIndex + 1)*MeshLength);
+		Segment.StartScale = FVector2D{ (Endpoints.EntranceWidth + WidthChange * MeshIndex / NumberOfMeshes) / 50.f, 1.f };
+		Segment.EndScale = FVector2D{ (Endpoints.EntranceWidth + WidthChange * (MeshIndex + 1) / NumberOfMeshes) / 50.f, 1.f };
+		Geometry.Segments.Add(Segment);
+	}
+	return Geometry;
 }
 
-void ALane::SetupSplineMeshes()
+
+void ALane::ApplyGeometry(const FLaneGeometry& Geometry)
 {
+	Spline->SplineCurves = Geometry.SplineCurves;
+	Spline->UpdateSpline();
+
 	// remove previous spline meshes
 	for (auto& SplineMeshComponent : SplineMeshComponents)
 	{
@@ -122,23 +189,8 @@ void ALane::SetupSplineMeshes()
 	SplineMeshComponents.Empty();
 
 	// setup the SplineMeshComponents
-	float MaxMeshLengthCM = 100.f*MaxMeshLength;
-	int NumberOfMeshes = FMath::CeilToInt(Spline->GetSplineLength() / MaxMeshLengthCM);
-	float MeshLength = Spline->GetSplineLength() / NumberOfMeshes;
-
-	float EntranceWidth = MyFork->EntranceTriggerVolume->GetScaledBoxExtent().Y;
-	float ExitWidth = MyExit->TriggerVolume->GetScaledBoxExtent().Y;
-	float WidthChange = ExitWidth - EntranceWidth;
-
-	for (int MeshIndex = 0; MeshIndex < NumberOfMeshes; MeshIndex++)
+	for (const FLaneSegment& Segment : Geometry.Segments)
 	{
-		auto StartPosition = Spline->GetLocationAtDistanceAlongSpline(MeshIndex*MeshLength, ESplineCoordinateSpace::Local);
-		auto EndPosition = Spline->GetLocationAtDistanceAlongSpline((MeshIndex + 1)*MeshLength, ESplineCoordinateSpace::Local);
-		auto StartTangent = Spline->GetTangentAtDistanceAlongSpline(MeshIndex*MeshLength, ESplineCoordinateSpace::Local);
-		auto EndTangent = Spline->GetTangentAtDistanceAlongSpline((MeshIndex + 1)*MeshLength, ESplineCoordinateSpace::Local);
-		auto StartDirection = StartTangent.GetSafeNormal();
-		auto EndDirection = EndTangent.GetSafeNormal();
-
 		USplineMeshComponent* SplineMesh = NewObject<USplineMeshComponent>(this);
 
 		SplineMesh->CreationMethod = EComponentCreationMethod::Instance;
@@ -147,16 +199,15 @@ void ALane::SetupSplineMeshes()
 		SplineMesh->SetStaticMesh(Mesh);
 		SplineMesh->SetMaterial(0, Cast<UMaterialInterface>(Material));
 
-		SplineMesh->SetStartPosition(StartPosition);
-		SplineMesh->SetEndPosition(EndPosition);
-		SplineMesh->SetStartTangent(StartDirection);
-		SplineMesh->SetEndTangent(EndDirection);
+		SplineMesh->SetStartPosition(Segment.StartPosition);
+		SplineMesh->SetEndPosition(Segment.EndPosition);
+		SplineMesh->SetStartTangent(Segment.StartDirection);
+		SplineMesh->SetEndTangent(Segment.EndDirection);
 
-		SplineMesh->SetStartScale(FVector2D{ (EntranceWidth + WidthChange * MeshIndex / NumberOfMeshes) / 50.f, 1.f });
-		SplineMesh->SetEndScale(FVector2D{ (EntranceWidth + WidthChange * (MeshIndex + 1) / NumberOfMeshes) / 50.f, 1.f });
+		SplineMesh->SetStartScale(Segment.StartScale);
+		SplineMesh->SetEndScale(Segment.EndScale);
 
-		SplineMesh->SetCollisionProfileName(FName("OverlapAll"));
-		SplineMesh->SetGenerateOverlapEvents(true);
+		TriggerCollision::SetupTrigger(SplineMesh);
 		
 		SplineMesh->RegisterComponent();
 		SplineMesh->UpdateRenderStateAndCollision();
@@ -166,6 +217,28 @@ void ALane::SetupSplineMeshes()
 }
 
 
+void ALane::BuildLanes(const TArray<ALane*>& Lanes)
+{
+	TArray<FLaneEndpoints> Endpoints;
+	for (ALane* Lane : Lanes)
+	{
+		Endpoints.Add(Lane->GetEndpoints());
+	}
+
+	TArray<FLaneGeometry> Geometries;
+	Geometries.SetNum(Lanes.Num());
+	ParallelFor(Lanes.Num(), [&Endpoints, &Geometries](int32 i) {
+		Geometries[i] = ComputeGeometry(Endpoints[i]);
+	});
+
+	// Components can only be created on the game thread
+	for (int32 i = 0; i < Lanes.Num(); i++)
+	{
+		Lanes[i]->ApplyGeometry(Geometries[i]);
+	}
+}
+
+
 // Reference: "2011_Curvature variation minimizing cubic Hermite interpolants"
 bool ALane::MinimumCurvatureVariation(FVector2D p0, FVector2D p1, FVector2D d0, FVector2D d1, float& OutAlpha0, float& OutAlpha1)
 {
@@ -0,0 +1,103 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "LaneConflicts.h"
+
+
+void FLaneConflictMatrix::Reset()
+{
+	LaneIndices.Empty();
+	LaneNames.Empty();
+	Conflicts.Empty();
+}
+
+
+int32 FLaneConflictMatrix::AddLane(const FString& Lane)
+{
+	if (const int32* Found = LaneIndices.Find(Lane))
+	{
+		return *Found;
+	}
+	int32 Index = Conflicts.Num();
+	LaneIndices.Add(Lane, Index);
+	LaneNames.Add(Lane);
+	for (TBitArray<>& Row : Conflicts)
+	{
+		Row.Add(false);
+	}
+	Conflicts.Emplace(false, Index + 1);
+	Conflicts[Index][Index] = true;
+	return Index;
+}
+
+
+void FLaneConflictMatrix::SetConflict(int32 LaneA, int32 LaneB, bool bConflict)
+{
+	if (LaneA != LaneB)
+	{
+		Conflicts[LaneA][LaneB] = bConflict;
+		Conflicts[LaneB][LaneA] = bConflict;
+	}
+}
+
+
+int32 FLaneConflictMatrix::FindLane(const FString& Lane) const
+{
+	const int32* Found = LaneIndices.Find(Lane);
+	return Found != nullptr ? *Found : INDEX_NONE;
+}
+
+
+bool FLaneConflictMatrix::AnyConflict(const TBitArray<>& Lanes, const TBitArray<>& Others) const
+{
+	for (TConstSetBitIterator<> It(Lanes); It; ++It)
+	{
+		if (It.GetIndex() < Conflicts.Num() && Intersects(Conflicts[It.GetIndex()], Others))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+void FLaneConflictMatrix::SetLane(TBitArray<>& Lanes, int32 Lane, bool bValue)
+{
+	while (Lanes.Num() <= Lane)
+	{
+		Lanes.Add(false);
+	}
+	Lanes[Lane] = bValue;
+}
+
+
+bool FLaneConflictMatrix::Intersects(const TBitArray<>& A, const TBitArray<>& B)
+{
+	// Bits past Num() are kept cleared
+	int32 NumWords = FMath::DivideAndRoundUp(FMath::Min(A.Num(), B.Num()), NumBitsPerDWORD);
+	const uint32* WordsA = A.GetData();
+	const uint32* WordsB = B.GetData();
+	for (int32 i = 0; i < NumWords; i++)
+	{
+		if ((WordsA[i] & WordsB[i]) != 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+void FLaneConflictMatrix::UnionWith(TBitArray<>& Into, const TBitArray<>& From)
+{
+	while (Into.Num() < From.Num())
+	{
+		Into.Add(false);
+	}
+	int32 NumWords = FMath::DivideAndRoundUp(From.Num(), NumBitsPerDWORD);
+	uint32* WordsInto = Into.GetData();
+	const uint32* WordsFrom = From.GetData();
+	for (int32 i = 0; i < NumWords; i++)
+	{
+		WordsInto[i] |= WordsFrom[i];
+	}
+}
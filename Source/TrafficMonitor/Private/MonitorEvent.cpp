@@ -0,0 +1,14 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "MonitorEvent.h"
+
+
+FString FMonitorEvent::ToAtom(int32 Time) const
+{
+	FString Atom = Predicate + "(";
+	for (const FString& Argument : Arguments)
+	{
+		Atom += Argument + ", ";
+	}
+	return Atom + FString::FromInt(Time) + ").";
+}
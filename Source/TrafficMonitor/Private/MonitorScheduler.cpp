@@ -0,0 +1,155 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "MonitorScheduler.h"
+#include "Runtime/Core/Public/HAL/IConsoleManager.h"
+#include "Async/Async.h"
+#include "EngineUtils.h"
+
+// Developer
+#include "IntersectionMonitor.h"
+
+
+static float SolveBudgetMs = 2.f;
+static FAutoConsoleVariableRef CVarSolveBudgetMs(
+	TEXT("TrafficMonitor.SolveBudgetMs"),
+	SolveBudgetMs,
+	TEXT("Milliseconds per frame spent on the solve requests of all intersection monitors. At least one request is served every frame."));
+
+static FAutoConsoleCommandWithWorldAndArgs ReloadRulesCommand(
+	TEXT("TrafficMonitor.ReloadRules"),
+	TEXT("Re-reads the rule files of all intersection monitors, or switches all of them to the given file of the LogicSolver directory. ")
+	TEXT("Monitors keep their events and switch once the new program is parsed and validated."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World) {
+		if (UMonitorScheduler* Scheduler = World != nullptr ? World->GetSubsystem<UMonitorScheduler>() : nullptr)
+		{
+			Scheduler->ReloadRules(Args.Num() > 0 ? Args[0] : FString());
+		}
+	}));
+
+
+void UMonitorScheduler::RequestSolve(AIntersectionMonitor* Monitor)
+{
+	for (const FSolveRequest& Request : PendingRequests)
+	{
+		if (Request.Monitor == Monitor)
+		{
+			return; // The pending solve will see the latest events
+		}
+	}
+	PendingRequests.Add({ Monitor, GFrameCounter });
+}
+
+
+void UMonitorScheduler::CancelSolve(AIntersectionMonitor* Monitor)
+{
+	PendingRequests.RemoveAll([Monitor](const FSolveRequest& Request) {
+		return Request.Monitor == Monitor;
+	});
+}
+
+
+void UMonitorScheduler::ReloadRules(const FString& RulesFile)
+{
+	// One load per file, validated with the geometry of a monitor that is going to use it
+	TMap<FString, std::string> ValidationGeometries;
+	for (TActorIterator<AIntersectionMonitor> It(GetWorld()); It; ++It)
+	{
+		if (It->IsReady())
+		{
+			ValidationGeometries.FindOrAdd(RulesFile.IsEmpty() ? It->TrafficRulesFile : RulesFile) = It->GetGeometryProgram();
+		}
+	}
+	for (auto& Pair : ValidationGeometries)
+	{
+		FString RulesFileFullName = FTrafficRules::GetRulesFileFullName(Pair.Key);
+		std::string Geometry = Pair.Value;
+		FRulesReload Reload{ Pair.Key, !RulesFile.IsEmpty() };
+		Reload.Rules = Async(EAsyncExecution::ThreadPool, [RulesFileFullName, Geometry]() {
+			return FTrafficRules::Reload(RulesFileFullName, Geometry);
+		});
+		PendingReloads.Add(MoveTemp(Reload));
+		UE_LOG(LogTemp, Log, TEXT("Reloading the traffic rules %s for %s monitors."), *Pair.Key, RulesFile.IsEmpty() ? TEXT("its") : TEXT("all"));
+	}
+}
+
+
+void UMonitorScheduler::SwitchReloadedRules()
+{
+	for (int32 i = 0; i < PendingReloads.Num(); i++)
+	{
+		FRulesReload& Reload = PendingReloads[i];
+		if (!Reload.Rules.IsReady())
+		{
+			continue;
+		}
+		TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> Rules = Reload.Rules.Get();
+		if (Rules.IsValid())
+		{
+			int32 NumSwitched = 0;
+			for (TActorIterator<AIntersectionMonitor> It(GetWorld()); It; ++It)
+			{
+				if (It->IsReady() && (Reload.bSwitchAllMonitors || It->TrafficRulesFile == Reload.RulesFile))
+				{
+					It->SetTrafficRules(Reload.RulesFile, Rules);
+					NumSwitched++;
+				}
+			}
+			UE_LOG(LogTemp, Log, TEXT("Switched %d monitors to the reloaded traffic rules %s."), NumSwitched, *Reload.RulesFile);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Error, TEXT("Kept the previous traffic rules: %s failed to load."), *Reload.RulesFile);
+		}
+		PendingReloads.RemoveAt(i--);
+	}
+}
+
+
+void UMonitorScheduler::Tick(float DeltaTime)
+{
+	// Before serving the requests, so that no solve of this frame uses the previous rules
+	SwitchReloadedRules();
+
+	PendingRequests.RemoveAll([](const FSolveRequest& Request) {
+		return !Request.Monitor.IsValid();
+	});
+
+	// Waiting vehicles first, then older requests
+	auto Priority = [](const FSolveRequest& Request) {
+		return int64(Request.Monitor->GetSolvePriority()) * 60 + int64(GFrameCounter - Request.RequestFrame);
+	};
+	PendingRequests.StableSort([&Priority](const FSolveRequest& A, const FSolveRequest& B) {
+		return Priority(A) > Priority(B);
+	});
+
+	// Solving may request another solve, which is then served on a later frame
+	int32 NumRequests = PendingRequests.Num();
+	double Deadline = FPlatformTime::Seconds() + SolveBudgetMs / 1000.0;
+	int32 NumServed = 0;
+	while (NumServed < NumRequests && (NumServed == 0 || FPlatformTime::Seconds() < Deadline))
+	{
+		AIntersectionMonitor* Monitor = PendingRequests[NumServed].Monitor.Get();
+		PendingRequests[NumServed].Monitor.Reset();
+		NumServed++;
+		Monitor->RunScheduledSolve();
+	}
+	PendingRequests.RemoveAt(0, NumServed);
+
+	if (PendingRequests.Num() > 0)
+	{
+		NumDeferredSolves += PendingRequests.Num();
+		UE_LOG(LogTemp, Verbose, TEXT("Deferred %d monitor solves to the next frame (%lld so far)."), PendingRequests.Num(), NumDeferredSolves);
+	}
+}
+
+
+bool UMonitorScheduler::IsTickable() const
+{
+	return (PendingRequests.Num() > 0 || PendingReloads.Num() > 0) && !IsTemplate();
+}
+
+
+TStatId UMonitorScheduler::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UMonitorScheduler, STATGROUP_Tickables);
+}
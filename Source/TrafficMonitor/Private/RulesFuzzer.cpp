@@ -0,0 +1,336 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "RulesFuzzer.h"
+#include "Runtime/Core/Public/Misc/FileHelper.h"
+
+
+bool FFuzzGeometry::Load(const FString& FileFullName)
+{
+	FString Text;
+	if (!FFileHelper::LoadFileToString(Text, *FileFullName))
+	{
+		return false;
+	}
+	return Parse(Text);
+}
+
+
+bool FFuzzGeometry::Parse(const FString& Text)
+{
+	Facts = TCHAR_TO_UTF8(*Text);
+
+	TArray<FString> Lines;
+	Text.ParseIntoArrayLines(Lines);
+	for (const FString& Line : Lines)
+	{
+		int32 Open;
+		int32 Close;
+		if (!Line.FindChar('(', Open) || !Line.FindLastChar(')', Close) || Close < Open)
+		{
+			continue;
+		}
+		FString Predicate = Line.Left(Open).TrimStartAndEnd();
+		TArray<FString> Arguments;
+		Line.Mid(Open + 1, Close - Open - 1).ParseIntoArray(Arguments, TEXT(","));
+		for (FString& Argument : Arguments)
+		{
+			Argument.TrimStartAndEndInline();
+		}
+
+		if (Predicate == TEXT("laneFromTo") && Arguments.Num() == 3)
+		{
+			Forks.AddUnique(Arguments[1]);
+			LanesByFork.FindOrAdd(Arguments[1]).Add(Arguments[0]);
+		}
+		else if (Predicate == TEXT("laneCorrectSignal") && Arguments.Num() == 2)
+		{
+			LaneSignals.Add(Arguments[0], Arguments[1]);
+		}
+		else if (Predicate == TEXT("overlaps") && Arguments.Num() == 2)
+		{
+			LaneOverlaps.FindOrAdd(Arguments[0]).Add(Arguments[1]);
+		}
+	}
+	return Forks.Num() > 0;
+}
+
+
+FRulesFuzzer::FRulesFuzzer(TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> InRules, const FFuzzGeometry& InGeometry, int32 InMaxVehicles)
+	: Rules(InRules)
+	, Geometry(InGeometry)
+	, MaxVehicles(FMath::Max(InMaxVehicles, 1))
+{
+}
+
+
+FFuzzScenario FRulesFuzzer::Generate(FRandomStream& Random) const
+{
+	struct FVehicleTimes
+	{
+		FString Fork;
+		FString Lane;
+		int32 Arrival;
+		int32 Entrance;
+		int32 LaneExit;
+		int32 MonitorExit;
+	};
+
+	int32 NumVehicles = Random.RandRange(1, MaxVehicles);
+	TMap<FString, int32> ForkFreeAt; // When the previous vehicle on the fork entered
+	TArray<FVehicleTimes> Vehicles;
+	int32 LastTime = 0;
+	for (int32 i = 0; i < NumVehicles; i++)
+	{
+		FVehicleTimes Times;
+		Times.Fork = Geometry.Forks[Random.RandRange(0, Geometry.Forks.Num() - 1)];
+		const TArray<FString>& Lanes = Geometry.LanesByFork.FindChecked(Times.Fork);
+		Times.Lane = Lanes[Random.RandRange(0, Lanes.Num() - 1)];
+		Times.Arrival = FMath::Max(Random.RandRange(0, 2 * NumVehicles), ForkFreeAt.FindRef(Times.Fork));
+		Times.Entrance = Times.Arrival + Random.RandRange(1, 4);
+		Times.LaneExit = Times.Entrance + Random.RandRange(1, 6);
+		Times.MonitorExit = Times.LaneExit + Random.RandRange(0, 2);
+		ForkFreeAt.Add(Times.Fork, Times.Entrance);
+		LastTime = FMath::Max(LastTime, Times.MonitorExit);
+		Vehicles.Add(Times);
+	}
+
+	FFuzzScenario Scenario;
+	int32 Now = Random.RandRange(0, LastTime);
+	for (int32 i = 0; i < Vehicles.Num(); i++)
+	{
+		const FVehicleTimes& Times = Vehicles[i];
+		if (Times.MonitorExit <= Now || Times.Arrival > Now)
+		{
+			continue;
+		}
+		FString Vehicle = FString::Printf(TEXT("v_%d"), i);
+		Scenario.Events.Add(FMonitorEvent("arrivesAtForkAtTime", { Vehicle, Times.Fork }, Times.Arrival));
+		Scenario.Events.Add(FMonitorEvent("signalsAtForkAtTime", { Vehicle, Geometry.LaneSignals.FindRef(Times.Lane), Times.Fork }, Times.Arrival));
+		if (Times.Entrance <= Now)
+		{
+			Scenario.Events.Add(FMonitorEvent("entersForkAtTime", { Vehicle, Times.Fork }, Times.Entrance));
+			Scenario.Events.Add(FMonitorEvent("entersLaneAtTime", { Vehicle, Times.Lane }, Times.Entrance));
+		}
+		if (Times.LaneExit <= Now)
+		{
+			Scenario.Events.Add(FMonitorEvent("leavesLaneAtTime", { Vehicle, Times.Lane }, Times.LaneExit));
+		}
+	}
+	return Scenario;
+}
+
+
+EFuzzFailure FRulesFuzzer::Check(const FFuzzScenario& Scenario) const
+{
+	FDecisionSet Decisions;
+	if (!Rules->Solve(ToProgram(Scenario), Decisions))
+	{
+		return EFuzzFailure::Unsatisfiable;
+	}
+
+	// Vehicles that arrived but did not enter, and the lanes they want
+	TSet<FString> Entered;
+	TMap<FString, TArray<FString>> Waiting;
+	for (const FMonitorEvent& Event : Scenario.Events)
+	{
+		if (Event.Predicate == TEXT("entersForkAtTime"))
+		{
+			Entered.Add(Event.Arguments[0]);
+		}
+	}
+	for (const FMonitorEvent& Event : Scenario.Events)
+	{
+		if (Event.Predicate == TEXT("arrivesAtForkAtTime") && !Entered.Contains(Event.Arguments[0]))
+		{
+			Waiting.FindOrAdd(Event.Arguments[0]);
+		}
+		else if (Event.Predicate == TEXT("signalsAtForkAtTime") && !Entered.Contains(Event.Arguments[0]))
+		{
+			TArray<FString>& WantedLanes = Waiting.FindOrAdd(Event.Arguments[0]);
+			for (const FString& Lane : Geometry.LanesByFork.FindRef(Event.Arguments[2]))
+			{
+				if (Geometry.LaneSignals.FindRef(Lane) == Event.Arguments[1])
+				{
+					WantedLanes.Add(Lane);
+				}
+			}
+		}
+	}
+
+	TSet<FString> RightOfWay(Decisions.RightOfWay);
+	TSet<FString> Yielding;
+	for (const FYieldDecision& Yield : Decisions.MustYield)
+	{
+		Yielding.Add(Yield.Vehicle);
+	}
+	if (RightOfWay.Intersect(Yielding).Num() > 0)
+	{
+		return EFuzzFailure::Conflict;
+	}
+
+	TArray<FString> Going;
+	for (const auto& VehicleAndLanes : Waiting)
+	{
+		if (RightOfWay.Contains(VehicleAndLanes.Key))
+		{
+			Going.Add(VehicleAndLanes.Key);
+		}
+	}
+	if (Waiting.Num() > 0 && Going.Num() == 0)
+	{
+		// Waiting for a vehicle that entered, e.g. to clear an overlapping lane, ends when it moves on
+		bool bAnyCanMove = false;
+		for (const FYieldDecision& Yield : Decisions.MustYield)
+		{
+			bAnyCanMove |= Waiting.Contains(Yield.Vehicle) && !Waiting.Contains(Yield.YieldsTo);
+		}
+		if (!bAnyCanMove)
+		{
+			return EFuzzFailure::Deadlock;
+		}
+	}
+	for (int32 i = 0; i < Going.Num(); i++)
+	{
+		for (int32 j = i + 1; j < Going.Num(); j++)
+		{
+			for (const FString& Lane : Waiting[Going[i]])
+			{
+				const TSet<FString>* Overlapping = Geometry.LaneOverlaps.Find(Lane);
+				for (const FString& OtherLane : Waiting[Going[j]])
+				{
+					if (Overlapping != nullptr && Overlapping->Contains(OtherLane))
+					{
+						return EFuzzFailure::Conflict;
+					}
+				}
+			}
+		}
+	}
+	return EFuzzFailure::None;
+}
+
+
+FFuzzScenario FRulesFuzzer::MakeYieldToInsideScenario() const
+{
+	// Prefer lanes of different forks, as both vehicles cannot be at the same fork at once
+	FString InsideLane;
+	FString WaitingLane;
+	FString InsideFork;
+	FString WaitingFork;
+	for (const auto& ForkAndLanes : Geometry.LanesByFork)
+	{
+		for (const FString& Lane : ForkAndLanes.Value)
+		{
+			for (const auto& OtherForkAndLanes : Geometry.LanesByFork)
+			{
+				for (const FString& OtherLane : OtherForkAndLanes.Value)
+				{
+					const TSet<FString>* Overlapping = Geometry.LaneOverlaps.Find(OtherLane);
+					bool bBetter = InsideLane.IsEmpty() || (InsideFork == WaitingFork && ForkAndLanes.Key != OtherForkAndLanes.Key);
+					if (Lane != OtherLane && Overlapping != nullptr && Overlapping->Contains(Lane) && bBetter)
+					{
+						InsideLane = Lane;
+						InsideFork = ForkAndLanes.Key;
+						WaitingLane = OtherLane;
+						WaitingFork = OtherForkAndLanes.Key;
+					}
+				}
+			}
+		}
+	}
+
+	FFuzzScenario Scenario;
+	if (InsideLane.IsEmpty())
+	{
+		return Scenario;
+	}
+	Scenario.Events.Add(FMonitorEvent("arrivesAtForkAtTime", { TEXT("v_0"), InsideFork }, 0));
+	Scenario.Events.Add(FMonitorEvent("signalsAtForkAtTime", { TEXT("v_0"), Geometry.LaneSignals.FindRef(InsideLane), InsideFork }, 0));
+	Scenario.Events.Add(FMonitorEvent("entersForkAtTime", { TEXT("v_0"), InsideFork }, 1));
+	Scenario.Events.Add(FMonitorEvent("entersLaneAtTime", { TEXT("v_0"), InsideLane }, 1));
+	Scenario.Events.Add(FMonitorEvent("arrivesAtForkAtTime", { TEXT("v_1"), WaitingFork }, 2));
+	Scenario.Events.Add(FMonitorEvent("signalsAtForkAtTime", { TEXT("v_1"), Geometry.LaneSignals.FindRef(WaitingLane), WaitingFork }, 2));
+	return Scenario;
+}
+
+
+FFuzzScenario FRulesFuzzer::Minimize(const FFuzzScenario& Scenario, EFuzzFailure Failure) const
+{
+	FFuzzScenario Current = Scenario;
+
+	// Whole vehicles
+	bool bShrunk = true;
+	while (bShrunk)
+	{
+		bShrunk = false;
+		TArray<FString> Vehicles;
+		for (const FMonitorEvent& Event : Current.Events)
+		{
+			Vehicles.AddUnique(Event.Arguments[0]);
+		}
+		for (const FString& Vehicle : Vehicles)
+		{
+			FFuzzScenario Candidate = Current;
+			Candidate.Events.RemoveAll([&Vehicle](const FMonitorEvent& Event) { return Event.Arguments[0] == Vehicle; });
+			if (Check(Candidate) == Failure)
+			{
+				Current = MoveTemp(Candidate);
+				bShrunk = true;
+				break;
+			}
+		}
+	}
+
+	// The latest events of each vehicle, which keeps the others plausible
+	bShrunk = true;
+	while (bShrunk)
+	{
+		bShrunk = false;
+		for (int32 i = Current.Events.Num() - 1; i >= 0; i--)
+		{
+			bool bLatestOfVehicle = i == Current.Events.Num() - 1
+				|| Current.Events[i + 1].Arguments[0] != Current.Events[i].Arguments[0];
+			if (!bLatestOfVehicle)
+			{
+				continue;
+			}
+			FFuzzScenario Candidate = Current;
+			Candidate.Events.RemoveAt(i);
+			if (Check(Candidate) == Failure)
+			{
+				Current = MoveTemp(Candidate);
+				bShrunk = true;
+				break;
+			}
+		}
+	}
+	return Current;
+}
+
+
+std::string FRulesFuzzer::ToProgram(const FFuzzScenario& Scenario) const
+{
+	std::string Program;
+	for (const FMonitorEvent& Event : Scenario.Events)
+	{
+		Program += TCHAR_TO_UTF8(*Event.ToAtom());
+		Program += "\n";
+	}
+	return Program + Geometry.Facts;
+}
+
+
+const TCHAR* FRulesFuzzer::ToString(EFuzzFailure Failure)
+{
+	switch (Failure)
+	{
+	case EFuzzFailure::Unsatisfiable:
+		return TEXT("unsatisfiable");
+	case EFuzzFailure::Deadlock:
+		return TEXT("deadlock");
+	case EFuzzFailure::Conflict:
+		return TEXT("conflict");
+	default:
+		return TEXT("none");
+	}
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "ShadowEvaluator.h"
+#include "HAL/RunnableThread.h"
+#include "HAL/Event.h"
+#include "Runtime/Core/Public/Misc/Paths.h"
+
+// STL
+#include <fstream>
+
+
+FShadowEvaluator::FShadowEvaluator(const FString& InMonitorName, TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> InShadowRules)
+	: MonitorName(InMonitorName)
+	, ShadowRules(InShadowRules)
+{
+	DivergenceFileFullName = FPaths::ProjectSavedDir() + MonitorName + "ShadowDivergences.log";
+	std::ofstream DivergenceFile(TCHAR_TO_UTF8(*DivergenceFileFullName), std::ios::trunc);
+	DivergenceFile << "% Decisions of " << TCHAR_TO_UTF8(*ShadowRules->GetFileFullName())
+		<< " that differ from the applied ones, with the facts they were solved for.\n";
+	DivergenceFile.close();
+
+	WorkAvailable = FPlatformProcess::GetSynchEventFromPool(false);
+	Thread = FRunnableThread::Create(this, *(MonitorName + TEXT("ShadowEvaluator")), 0, TPri_Lowest);
+}
+
+
+FShadowEvaluator::~FShadowEvaluator()
+{
+	Stop();
+	if (Thread != nullptr)
+	{
+		Thread->WaitForCompletion();
+		delete Thread;
+	}
+	FPlatformProcess::ReturnSynchEventToPool(WorkAvailable);
+}
+
+
+void FShadowEvaluator::Submit(const std::string& Program, const FDecisionSet& ActiveDecisions)
+{
+	NumSubmitted.Increment();
+	if (NumPending.GetValue() >= MaxPending)
+	{
+		NumDropped.Increment();
+		return;
+	}
+	NumPending.Increment();
+	Jobs.Enqueue({ Program, ActiveDecisions });
+	WorkAvailable->Trigger();
+}
+
+
+uint32 FShadowEvaluator::Run()
+{
+	while (bStopping.GetValue() == 0)
+	{
+		FJob Job;
+		if (Jobs.Dequeue(Job))
+		{
+			NumPending.Decrement();
+			Evaluate(Job);
+		}
+		else
+		{
+			WorkAvailable->Wait(100);
+		}
+	}
+	return 0;
+}
+
+
+void FShadowEvaluator::Stop()
+{
+	bStopping.Set(1);
+	WorkAvailable->Trigger();
+}
+
+
+void FShadowEvaluator::Evaluate(const FJob& Job)
+{
+	FDecisionSet ShadowDecisions;
+	if (!ShadowRules->Solve(Job.Program, ShadowDecisions))
+	{
+		NumFailed.Increment();
+		return;
+	}
+	NumEvaluated.Increment();
+
+	TSet<FString> Active = Job.ActiveDecisions.ToAtoms();
+	TSet<FString> Shadow = ShadowDecisions.ToAtoms();
+	TSet<FString> OnlyActive = Active.Difference(Shadow);
+	TSet<FString> OnlyShadow = Shadow.Difference(Active);
+	if (OnlyActive.Num() == 0 && OnlyShadow.Num() == 0)
+	{
+		return;
+	}
+
+	int32 Divergence = NumDivergent.Increment();
+	std::ofstream DivergenceFile(TCHAR_TO_UTF8(*DivergenceFileFullName), std::ios::app);
+	DivergenceFile << "\n% Divergence " << Divergence << "\n";
+	for (const FString& Atom : OnlyActive)
+	{
+		DivergenceFile << "% applied only: " << TCHAR_TO_UTF8(*Atom) << "\n";
+	}
+	for (const FString& Atom : OnlyShadow)
+	{
+		DivergenceFile << "% shadow only: " << TCHAR_TO_UTF8(*Atom) << "\n";
+	}
+	DivergenceFile << Job.Program;
+	DivergenceFile.close();
+}
+
+
+void FShadowEvaluator::LogStatistics() const
+{
+	UE_LOG(LogTemp, Log, TEXT("%s: shadow rules %s diverged on %d of %d event sets (%d unsolved, %d dropped of %d)."),
+		*MonitorName,
+		*FPaths::GetCleanFilename(ShadowRules->GetFileFullName()),
+		NumDivergent.GetValue(),
+		NumEvaluated.GetValue(),
+		NumFailed.GetValue(),
+		NumDropped.GetValue(),
+		NumSubmitted.GetValue());
+}
@@ -0,0 +1,206 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "SolverServiceClient.h"
+
+// Developer
+#include "SolverServiceProtocol.h"
+
+// STL
+#include <cstring>
+
+
+using namespace TrafficSolverService;
+
+
+FSolverServiceClient& FSolverServiceClient::Get()
+{
+	static FSolverServiceClient Client;
+	return Client;
+}
+
+
+FSolverServiceClient::~FSolverServiceClient()
+{
+	Disconnect();
+}
+
+
+bool FSolverServiceClient::Connect()
+{
+	SharedMemory = FPlatformMemory::MapNamedSharedMemoryRegion(
+		RegionName,
+		false, // Only the service creates the region
+		FPlatformMemory::ESharedMemoryAccess::Read | FPlatformMemory::ESharedMemoryAccess::Write,
+		RegionBytes);
+	if (SharedMemory == nullptr)
+	{
+		return false;
+	}
+
+	Region = static_cast<FRegion*>(SharedMemory->GetAddress());
+	if (Region->Magic != Magic || Region->Version != Version)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Solver service has an incompatible protocol version %u!"), Region->Version);
+		Disconnect();
+		return false;
+	}
+
+	LastHeartbeat = Region->Heartbeat.load();
+	LastHeartbeatChange = FPlatformTime::Seconds();
+	DiscardedTickets.Empty();
+	UE_LOG(LogTemp, Log, TEXT("Connected to the solver service."));
+	return true;
+}
+
+
+void FSolverServiceClient::Disconnect()
+{
+	if (SharedMemory != nullptr)
+	{
+		FPlatformMemory::UnmapNamedSharedMemoryRegion(SharedMemory);
+	}
+	SharedMemory = nullptr;
+	Region = nullptr;
+}
+
+
+bool FSolverServiceClient::IsServiceAlive()
+{
+	if (Region == nullptr && !Connect())
+	{
+		return false;
+	}
+
+	double Now = FPlatformTime::Seconds();
+	uint64 Heartbeat = Region->Heartbeat.load();
+	if (Heartbeat != LastHeartbeat)
+	{
+		LastHeartbeat = Heartbeat;
+		LastHeartbeatChange = Now;
+	}
+	else if (Now - LastHeartbeatChange > HeartbeatTimeoutSeconds)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Solver service stopped responding, solving in-process."));
+		Disconnect();
+		return false;
+	}
+	return true;
+}
+
+
+bool FSolverServiceClient::Submit(const FString& RulesFileFullName, const std::string& Program, uint64& OutTicket)
+{
+	FTCHARToUTF8 RulesFile(*RulesFileFullName);
+	if (Program.size() > MaxProgramBytes || RulesFile.Length() >= int32(MaxRulesFileBytes) || !IsServiceAlive())
+	{
+		return false;
+	}
+
+	ReleaseDiscardedSlots();
+
+	// A ticket names its slot, so skip the tickets of slots still in use by slower requests
+	FSlot* FreeSlot = nullptr;
+	uint64 Ticket = NextTicket;
+	for (uint32 Attempt = 0; Attempt < NumSlots && FreeSlot == nullptr; Attempt++)
+	{
+		Ticket = NextTicket++;
+		FSlot& Candidate = Region->Slots[Ticket % NumSlots];
+		uint32_t Expected = Free;
+		if (Candidate.State.compare_exchange_strong(Expected, Writing))
+		{
+			FreeSlot = &Candidate;
+		}
+	}
+	if (FreeSlot == nullptr)
+	{
+		return false; // The ring is full
+	}
+	FSlot& Slot = *FreeSlot;
+
+	Slot.Ticket = Ticket;
+	FMemory::Memcpy(Slot.RulesFile, RulesFile.Get(), RulesFile.Length());
+	Slot.RulesFile[RulesFile.Length()] = '\0';
+	FMemory::Memcpy(Slot.Program, Program.data(), Program.size());
+	Slot.ProgramBytes = uint32_t(Program.size());
+	Slot.ResponseBytes = 0;
+	Slot.State.store(Ready);
+
+	OutTicket = Ticket;
+	return true;
+}
+
+
+FSolverServiceClient::EPollResult FSolverServiceClient::Poll(uint64 Ticket, FDecisionSet& OutDecisions)
+{
+	if (!IsServiceAlive())
+	{
+		return EPollResult::Failed;
+	}
+
+	FSlot& Slot = Region->Slots[Ticket % NumSlots];
+	if (Slot.Ticket != Ticket)
+	{
+		return EPollResult::Failed;
+	}
+	if (Slot.State.load() != Done)
+	{
+		return EPollResult::Pending;
+	}
+
+	FString Response = UTF8_TO_TCHAR(std::string(Slot.Response, Slot.ResponseBytes).c_str());
+	Slot.State.store(Free);
+
+	TArray<FString> Lines;
+	Response.ParseIntoArrayLines(Lines);
+	if (Lines.Num() == 0 || Lines[0] != TEXT("ok"))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Solver service: %s"), Lines.Num() > 0 ? *Lines[0] : TEXT("empty response"));
+		return EPollResult::Failed;
+	}
+	for (int32 i = 1; i < Lines.Num(); i++)
+	{
+		TArray<FString> Fields;
+		Lines[i].ParseIntoArrayWS(Fields);
+		if (Fields.Num() == 4 && Fields[0] == TEXT("y"))
+		{
+			OutDecisions.MustYield.Add({ Fields[1], Fields[2], Fields[3] });
+		}
+		else if (Fields.Num() == 2 && Fields[0] == TEXT("r"))
+		{
+			OutDecisions.RightOfWay.Add(Fields[1]);
+		}
+	}
+	return EPollResult::Done;
+}
+
+
+void FSolverServiceClient::Discard(uint64 Ticket)
+{
+	if (Region == nullptr)
+	{
+		return;
+	}
+
+	// The service may still be solving it; free the slot once it is done
+	FSlot& Slot = Region->Slots[Ticket % NumSlots];
+	uint32_t Expected = Done;
+	if (Slot.Ticket == Ticket && !Slot.State.compare_exchange_strong(Expected, Free))
+	{
+		DiscardedTickets.Add(Ticket);
+	}
+	ReleaseDiscardedSlots();
+}
+
+
+void FSolverServiceClient::ReleaseDiscardedSlots()
+{
+	for (auto It = DiscardedTickets.CreateIterator(); It; ++It)
+	{
+		FSlot& Slot = Region->Slots[*It % NumSlots];
+		uint32_t Expected = Done;
+		if (Slot.Ticket != *It || Slot.State.compare_exchange_strong(Expected, Free))
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
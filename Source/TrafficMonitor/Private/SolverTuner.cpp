@@ -0,0 +1,252 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "SolverTuner.h"
+
+// Developer
+#include "IntersectionMonitor.h"
+#include "LaneConflicts.h"
+#include "RulesFuzzer.h"
+#include "VehicleStates.h"
+
+
+double FSolverLatencies::Get(const FString& Metric) const
+{
+	if (Metric == TEXT("mean"))
+	{
+		return Mean;
+	}
+	if (Metric == TEXT("p50"))
+	{
+		return P50;
+	}
+	if (Metric == TEXT("p99"))
+	{
+		return P99;
+	}
+	if (Metric == TEXT("max"))
+	{
+		return Max;
+	}
+	return P95;
+}
+
+
+bool FSolverTuner::NeedsHybridState(const FTrafficRules& Rules, FString& OutError)
+{
+	OutError.Empty();
+	if (Rules.MayAffectDecisions(TEXT("arrivesAtForkAtTime")))
+	{
+		return false;
+	}
+	if (Rules.MayAffectDecisions(TEXT("waitingAtFork")))
+	{
+		return true;
+	}
+	OutError = Rules.GetFileFullName() + TEXT(" derives its decisions from neither the monitor events nor the vehicle states");
+	return false;
+}
+
+
+int32 FSolverTuner::AddTrace(const FAnalyticsTables& Trace, const std::string& Geometry, bool bHybridState)
+{
+	// The monitor's lane sets, to resolve signals and overlaps in the vehicle states
+	FLaneConflictMatrix Lanes;
+	TMap<FString, TBitArray<>> LanesByForkAndSignal;
+	FVehicleStates VehicleStates;
+	if (bHybridState)
+	{
+		FFuzzGeometry LaneGeometry;
+		LaneGeometry.Parse(UTF8_TO_TCHAR(Geometry.c_str()));
+		for (const auto& ForkAndLanes : LaneGeometry.LanesByFork)
+		{
+			for (const FString& Lane : ForkAndLanes.Value)
+			{
+				int32 LaneIndex = Lanes.AddLane(Lane);
+				FLaneConflictMatrix::SetLane(LanesByForkAndSignal.FindOrAdd(ForkAndLanes.Key + "/" + LaneGeometry.LaneSignals.FindRef(Lane)), LaneIndex, true);
+			}
+		}
+		for (const auto& LaneAndOverlaps : LaneGeometry.LaneOverlaps)
+		{
+			for (const FString& OtherLane : LaneAndOverlaps.Value)
+			{
+				Lanes.SetConflict(Lanes.AddLane(LaneAndOverlaps.Key), Lanes.AddLane(OtherLane), true);
+			}
+		}
+	}
+
+	const FAnalyticsEvents& Events = Trace.Events;
+	TMap<FString, double> LastEventTimes; // By vehicle atom
+	for (int32 i = 0; i < Events.Num(); i++)
+	{
+		LastEventTimes.Add(Trace.GetString(Events.Vehicle[i]), Events.Time[i]);
+	}
+
+	TArray<double> SolveTimes;
+	for (int32 i = 0; i < Trace.Solves.Num(); i++)
+	{
+		EAnalyticsSolve Kind = static_cast<EAnalyticsSolve>(Trace.Solves.Kind[i]);
+		if (Kind == EAnalyticsSolve::InProcess || Kind == EAnalyticsSolve::Service || Kind == EAnalyticsSolve::Component)
+		{
+			SolveTimes.AddUnique(Trace.Solves.Time[i]);
+		}
+	}
+	if (SolveTimes.Num() == 0)
+	{
+		for (double Time : Events.Time)
+		{
+			SolveTimes.AddUnique(Time);
+		}
+	}
+	SolveTimes.Sort();
+
+	// Events are in time order, so each solve extends the previous one's events
+	TMap<FString, TArray<FMonitorEvent>> ActorToEvents;
+	int32 NextEvent = 0;
+	int32 NumAdded = 0;
+	for (double SolveTime : SolveTimes)
+	{
+		for (; NextEvent < Events.Num() && Events.Time[NextEvent] <= SolveTime; NextEvent++)
+		{
+			FString Vehicle = Trace.GetString(Events.Vehicle[NextEvent]);
+			TArray<FString> Arguments = { Vehicle };
+			for (int32 Argument : { Events.Argument1[NextEvent], Events.Argument2[NextEvent] })
+			{
+				if (Argument != INDEX_NONE)
+				{
+					Arguments.Add(Trace.GetString(Argument));
+				}
+			}
+			TArray<FMonitorEvent>& VehicleEvents = ActorToEvents.FindOrAdd(Vehicle);
+			VehicleEvents.Emplace(Trace.GetString(Events.Predicate[NextEvent]), MoveTemp(Arguments), Events.TimeStep[NextEvent]);
+			if (bHybridState)
+			{
+				VehicleStates.Apply(Vehicle.RightChop(2), VehicleEvents.Last(), Lanes, LanesByForkAndSignal);
+			}
+		}
+		for (auto It = ActorToEvents.CreateIterator(); It; ++It)
+		{
+			if (LastEventTimes.FindRef(It.Key()) < SolveTime)
+			{
+				VehicleStates.Remove(It.Key().RightChop(2));
+				It.RemoveCurrent();
+			}
+		}
+		if (ActorToEvents.Num() > 0)
+		{
+			int32 NumTimeSteps;
+			if (bHybridState)
+			{
+				// The states are by actor name, the events by vehicle atom
+				TArray<FString> Vehicles;
+				for (const auto& Pair : ActorToEvents)
+				{
+					Vehicles.Add(Pair.Key.RightChop(2));
+				}
+				Programs.Add(VehicleStates.GetFacts(Vehicles, Lanes, true, NumTimeSteps) + Geometry);
+			}
+			else
+			{
+				Programs.Add(AIntersectionMonitor::GetEventsString(ActorToEvents, true, NumTimeSteps) + Geometry);
+			}
+			NumAdded++;
+		}
+	}
+	return NumAdded;
+}
+
+
+void FSolverTuner::Sample(int32 MaxPrograms)
+{
+	if (MaxPrograms <= 0 || Programs.Num() <= MaxPrograms)
+	{
+		return;
+	}
+	TArray<std::string> Sampled;
+	for (int32 i = 0; i < MaxPrograms; i++)
+	{
+		Sampled.Add(MoveTemp(Programs[int64(i) * Programs.Num() / MaxPrograms]));
+	}
+	Programs = MoveTemp(Sampled);
+}
+
+
+TArray<FSolverConfig> FSolverTuner::MakeGrid(const TArray<FString>& Configurations, const TArray<FString>& Heuristics, const TArray<int32>& Threads)
+{
+	TArray<FSolverConfig> Grid;
+	for (const FString& Configuration : Configurations)
+	{
+		for (const FString& Heuristic : Heuristics)
+		{
+			for (int32 NumThreads : Threads)
+			{
+				FSolverConfig Config;
+				if (Configuration != TEXT("default"))
+				{
+					Config.Arguments.Add("--configuration=" + Configuration);
+				}
+				if (Heuristic != TEXT("default"))
+				{
+					Config.Arguments.Add("--heuristic=" + Heuristic);
+				}
+				if (NumThreads > 1)
+				{
+					Config.Arguments.Add(FString::Printf(TEXT("--parallel-mode=%d"), NumThreads));
+				}
+				Grid.Add(Config);
+			}
+		}
+	}
+	return Grid;
+}
+
+
+FSolverLatencies FSolverTuner::Measure(const FTrafficRules& Rules, const FSolverConfig& Config, int32 NumRepeats, TArray<TSet<FString>>& InOutDecisions) const
+{
+	FSolverLatencies Latencies;
+	bool bReference = InOutDecisions.Num() == 0;
+	TArray<double> Milliseconds;
+	for (int32 i = 0; i < Programs.Num(); i++)
+	{
+		double Fastest = TNumericLimits<double>::Max();
+		FDecisionSet Decisions;
+		bool bSolved = true;
+		for (int32 Repeat = 0; Repeat < FMath::Max(NumRepeats, 1) && bSolved; Repeat++)
+		{
+			double StartTime = FPlatformTime::Seconds();
+			bSolved = Rules.Solve(Config, Programs[i], Decisions);
+			Fastest = FMath::Min(Fastest, 1000.0 * (FPlatformTime::Seconds() - StartTime));
+		}
+		Milliseconds.Add(Fastest);
+
+		TSet<FString> Atoms = bSolved ? Decisions.ToAtoms() : TSet<FString>();
+		Latencies.NumFailures += bSolved ? 0 : 1;
+		if (bReference)
+		{
+			InOutDecisions.Add(MoveTemp(Atoms));
+		}
+		else if (!InOutDecisions.IsValidIndex(i) || InOutDecisions[i].Num() != Atoms.Num() || !InOutDecisions[i].Includes(Atoms))
+		{
+			Latencies.NumMismatches++;
+		}
+	}
+	if (Milliseconds.Num() == 0)
+	{
+		return Latencies;
+	}
+
+	Milliseconds.Sort();
+	auto Percentile = [&Milliseconds](double Fraction) {
+		return Milliseconds[FMath::Min(Milliseconds.Num() - 1, int32(Fraction * Milliseconds.Num()))];
+	};
+	double Sum = 0.0;
+	for (double Time : Milliseconds)
+	{
+		Sum += Time;
+	}
+	Latencies.Mean = Sum / Milliseconds.Num();
+	Latencies.P50 = Percentile(0.5);
+	Latencies.P95 = Percentile(0.95);
+	Latencies.P99 = Percentile(0.99);
+	Latencies.Max = Milliseconds.Last();
+	return Latencies;
+}
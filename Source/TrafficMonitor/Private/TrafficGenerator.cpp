@@ -0,0 +1,140 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "TrafficGenerator.h"
+
+// Developer
+#include "Fork.h"
+#include "Lane.h"
+#include "TriggerCollision.h"
+#include "VehicleProxy.h"
+
+
+ATrafficGenerator::ATrafficGenerator(const FObjectInitializer &ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	RootComponent =
+		ObjectInitializer.CreateDefaultSubobject<USceneComponent>(this, TEXT("SceneRootComponent"));
+	RootComponent->SetMobility(EComponentMobility::Static);
+
+	PrimaryActorTick.bCanEverTick = true;
+}
+
+
+void ATrafficGenerator::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (Monitor == nullptr)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s has no monitor to generate traffic for!"), *GetName());
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	TArray<AActor*> OverlappingActors;
+	TriggerCollision::GetOverlappingTriggerActors(Monitor, ALane::StaticClass(), OverlappingActors);
+	for (AActor* Actor : OverlappingActors)
+	{
+		ALane* Lane = Cast<ALane>(Actor);
+		if (Lane->MyFork != nullptr && Lane->MyExit != nullptr)
+		{
+			Lanes.Add(Lane);
+		}
+	}
+	if (Lanes.Num() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s found no lanes in %s!"), *GetName(), *Monitor->GetName());
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	StartTime = GetWorld()->GetTimeSeconds();
+	LastReportTime = StartTime;
+}
+
+
+void ATrafficGenerator::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (NumSpawned > 0)
+	{
+		LogReport();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+
+void ATrafficGenerator::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	SpawnBudget += DeltaTime * VehiclesPerMinute / 60.f;
+	for (; SpawnBudget >= 1.f; SpawnBudget -= 1.f)
+	{
+		if (MaxVehicles > 0 && NumSpawned >= MaxVehicles)
+		{
+			SpawnBudget = 0.f;
+			break;
+		}
+
+		ALane* Lane = Lanes[FMath::RandRange(0, Lanes.Num() - 1)];
+		AVehicleProxy* Leader = LastProxyOnFork.FindRef(Lane->MyFork).Get();
+		if (Leader != nullptr && Leader->GetDistance() < Leader->MinimumGap + 2.f * Leader->Body->GetScaledBoxExtent().X)
+		{
+			NumDeferred++;
+			continue;
+		}
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Owner = this;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		FVector Direction = Lane->MyFork->GetActorForwardVector();
+		FVector Start = Lane->MyFork->GetActorLocation() - Direction * 100.f * ApproachLength;
+		AVehicleProxy* Proxy = GetWorld()->SpawnActor<AVehicleProxy>(Start, Direction.Rotation(), SpawnParams);
+		if (Proxy == nullptr)
+		{
+			continue;
+		}
+		float Speed = 100.f * FMath::FRandRange(MinSpeed, MaxSpeed);
+		Proxy->Init(this, Lane, Leader, 100.f * ApproachLength, 100.f * DepartureLength, Speed);
+		LastProxyOnFork.Add(Lane->MyFork, Proxy);
+		NumSpawned++;
+	}
+
+	float Now = GetWorld()->GetTimeSeconds();
+	if (ReportIntervalSeconds > 0.f && Now - LastReportTime >= ReportIntervalSeconds)
+	{
+		LastReportTime = Now;
+		LogReport();
+	}
+}
+
+
+void ATrafficGenerator::RecordTrip(float SpawnTime, float ArrivalTime, float FirstDecisionTime, float ProceedTime, float FinishTime)
+{
+	NumFinished++;
+	SumTripTime += FinishTime - SpawnTime;
+	if (ArrivalTime >= 0.f && FirstDecisionTime >= 0.f)
+	{
+		float DecisionLatency = FirstDecisionTime - ArrivalTime;
+		NumDecided++;
+		SumDecisionLatency += DecisionLatency;
+		MaxDecisionLatency = FMath::Max(MaxDecisionLatency, DecisionLatency);
+		SumWait += (ProceedTime >= 0.f ? ProceedTime : FinishTime) - ArrivalTime;
+	}
+}
+
+
+void ATrafficGenerator::LogReport() const
+{
+	float Minutes = FMath::Max((GetWorld()->GetTimeSeconds() - StartTime) / 60.f, SMALL_NUMBER);
+	UE_LOG(LogTemp, Log, TEXT("%s: %d proxies spawned (%d deferred), %d finished, %.1f vehicles/min through %s."),
+		*GetName(), NumSpawned, NumDeferred, NumFinished, NumFinished / Minutes, *Monitor->GetName());
+	UE_LOG(LogTemp, Log, TEXT("%s: decision latency %.3f s mean, %.3f s max; wait %.2f s mean; trip %.2f s mean; %d timed out."),
+		*GetName(),
+		NumDecided > 0 ? SumDecisionLatency / NumDecided : 0.f,
+		MaxDecisionLatency,
+		NumDecided > 0 ? SumWait / NumDecided : 0.f,
+		NumFinished > 0 ? SumTripTime / NumFinished : 0.f,
+		NumTimedOut);
+}
@@ -0,0 +1,663 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "TrafficRules.h"
+#include "Runtime/Core/Public/Misc/FileHelper.h"
+#include "Runtime/Core/Public/Misc/Paths.h"
+#include "Runtime/Core/Public/Misc/ScopeLock.h"
+
+#include "ClingoInclude.h"
+
+// STL
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+
+struct FTrafficRules::FParsedProgram
+{
+	std::vector<Clingo::AST::Statement> Statements;
+};
+
+
+namespace
+{
+	FCriticalSection RulesCacheLock;
+	TMap<FString, TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe>> RulesCache;
+
+	/// Adds the predicate of an atom, e.g. "p" of "p(X)", "-p(X)" or "p(1;2)". Other terms have none.
+	void AddAtomPredicate(const Clingo::AST::Term& Atom, TSet<FString>& OutPredicates)
+	{
+		if (Atom.data.is<Clingo::AST::Function>())
+		{
+			const Clingo::AST::Function& Function = Atom.data.get<Clingo::AST::Function>();
+			if (*Function.name != '\0')
+			{
+				OutPredicates.Add(FString(UTF8_TO_TCHAR(Function.name)));
+			}
+		}
+		else if (Atom.data.is<Clingo::Symbol>())
+		{
+			const Clingo::Symbol& Symbol = Atom.data.get<Clingo::Symbol>();
+			if (Symbol.type() == Clingo::SymbolType::Function && *Symbol.name() != '\0')
+			{
+				OutPredicates.Add(FString(UTF8_TO_TCHAR(Symbol.name())));
+			}
+		}
+		else if (Atom.data.is<Clingo::AST::UnaryOperation>()) // Classical negation
+		{
+			AddAtomPredicate(Atom.data.get<Clingo::AST::UnaryOperation>().argument, OutPredicates);
+		}
+		else if (Atom.data.is<Clingo::AST::Pool>())
+		{
+			for (const Clingo::AST::Term& Alternative : Atom.data.get<Clingo::AST::Pool>().arguments)
+			{
+				AddAtomPredicate(Alternative, OutPredicates);
+			}
+		}
+	}
+
+
+	/// Adds the predicate of a literal, and to OutNegated if it is default-negated. Comparisons have none.
+	void AddLiteralPredicate(const Clingo::AST::Literal& Literal, TSet<FString>& OutPredicates, TSet<FString>& OutNegated)
+	{
+		if (!Literal.data.is<Clingo::AST::Term>())
+		{
+			return;
+		}
+		TSet<FString> Predicates;
+		AddAtomPredicate(Literal.data.get<Clingo::AST::Term>(), Predicates);
+		OutPredicates.Append(Predicates);
+		if (Literal.sign != Clingo::AST::Sign::None)
+		{
+			OutNegated.Append(Predicates);
+		}
+	}
+
+
+	void AddConditionalLiteralPredicates(const Clingo::AST::ConditionalLiteral& Literal, TSet<FString>& OutPredicates, TSet<FString>& OutNegated)
+	{
+		AddLiteralPredicate(Literal.literal, OutPredicates, OutNegated);
+		for (const Clingo::AST::Literal& Condition : Literal.condition)
+		{
+			AddLiteralPredicate(Condition, OutPredicates, OutNegated);
+		}
+	}
+
+
+	/// False for theory atoms and disjoint constraints, which the analysis does not understand.
+	bool AddBodyPredicates(const Clingo::AST::BodyLiteral& Literal, TSet<FString>& OutPredicates, TSet<FString>& OutNegated)
+	{
+		TSet<FString> Predicates;
+		TSet<FString> Negated;
+		if (Literal.data.is<Clingo::AST::Literal>())
+		{
+			AddLiteralPredicate(Literal.data.get<Clingo::AST::Literal>(), Predicates, Negated);
+		}
+		else if (Literal.data.is<Clingo::AST::ConditionalLiteral>())
+		{
+			AddConditionalLiteralPredicates(Literal.data.get<Clingo::AST::ConditionalLiteral>(), Predicates, Negated);
+		}
+		else if (Literal.data.is<Clingo::AST::Aggregate>())
+		{
+			for (const Clingo::AST::ConditionalLiteral& Element : Literal.data.get<Clingo::AST::Aggregate>().elements)
+			{
+				AddConditionalLiteralPredicates(Element, Predicates, Negated);
+			}
+			// Aggregates need not be monotone, so count them as negation
+			Negated.Append(Predicates);
+		}
+		else if (Literal.data.is<Clingo::AST::BodyAggregate>())
+		{
+			for (const Clingo::AST::BodyAggregateElement& Element : Literal.data.get<Clingo::AST::BodyAggregate>().elements)
+			{
+				for (const Clingo::AST::Literal& Condition : Element.condition)
+				{
+					AddLiteralPredicate(Condition, Predicates, Negated);
+				}
+			}
+			Negated.Append(Predicates);
+		}
+		else
+		{
+			return false;
+		}
+		if (Literal.sign != Clingo::AST::Sign::None)
+		{
+			Negated.Append(Predicates);
+		}
+		OutPredicates.Append(Predicates);
+		OutNegated.Append(Negated);
+		return true;
+	}
+
+
+	/// Adds the predicates a rule head derives, and those of its conditions to the body's.
+	/// False if the head can hold in several ways, i.e. a choice, a disjunction or a negated head,
+	/// or if it is not understood.
+	bool AddHeadPredicates(const Clingo::AST::HeadLiteral& Head, TSet<FString>& OutHeadPredicates, TSet<FString>& OutBodyPredicates, TSet<FString>& OutNegated)
+	{
+		TSet<FString> Unused;
+		if (Head.data.is<Clingo::AST::Literal>())
+		{
+			const Clingo::AST::Literal& Literal = Head.data.get<Clingo::AST::Literal>();
+			AddLiteralPredicate(Literal, OutHeadPredicates, Unused);
+			return Literal.sign == Clingo::AST::Sign::None;
+		}
+		if (Head.data.is<Clingo::AST::Disjunction>())
+		{
+			const std::vector<Clingo::AST::ConditionalLiteral>& Elements = Head.data.get<Clingo::AST::Disjunction>().elements;
+			for (const Clingo::AST::ConditionalLiteral& Element : Elements)
+			{
+				AddLiteralPredicate(Element.literal, OutHeadPredicates, Unused);
+				for (const Clingo::AST::Literal& Condition : Element.condition)
+				{
+					AddLiteralPredicate(Condition, OutBodyPredicates, OutNegated);
+				}
+			}
+			return Elements.size() <= 1;
+		}
+		if (Head.data.is<Clingo::AST::Aggregate>())
+		{
+			for (const Clingo::AST::ConditionalLiteral& Element : Head.data.get<Clingo::AST::Aggregate>().elements)
+			{
+				AddLiteralPredicate(Element.literal, OutHeadPredicates, Unused);
+				for (const Clingo::AST::Literal& Condition : Element.condition)
+				{
+					AddLiteralPredicate(Condition, OutBodyPredicates, OutNegated);
+				}
+			}
+			return false;
+		}
+		if (Head.data.is<Clingo::AST::HeadAggregate>())
+		{
+			for (const Clingo::AST::HeadAggregateElement& Element : Head.data.get<Clingo::AST::HeadAggregate>().elements)
+			{
+				AddLiteralPredicate(Element.condition.literal, OutHeadPredicates, Unused);
+				for (const Clingo::AST::Literal& Condition : Element.condition.condition)
+				{
+					AddLiteralPredicate(Condition, OutBodyPredicates, OutNegated);
+				}
+			}
+			return false;
+		}
+		return false;
+	}
+
+
+	/// A rule's head predicates, and the predicates of its positive, unconditional body literals.
+	struct FRuleRequirement
+	{
+		TSet<FString> HeadPredicates;
+		TSet<FString> RequiredPredicates;
+	};
+
+
+	void AddRequiredPredicate(const Clingo::AST::BodyLiteral& Literal, TSet<FString>& OutPredicates)
+	{
+		if (Literal.sign == Clingo::AST::Sign::None && Literal.data.is<Clingo::AST::Literal>())
+		{
+			const Clingo::AST::Literal& Atom = Literal.data.get<Clingo::AST::Literal>();
+			if (Atom.sign == Clingo::AST::Sign::None && Atom.data.is<Clingo::AST::Term>())
+			{
+				AddAtomPredicate(Atom.data.get<Clingo::AST::Term>(), OutPredicates);
+			}
+		}
+	}
+
+
+	/// The predicates without which no atom of the predicate holds: itself, and those every rule deriving it needs.
+	/// Recursion through the predicate adds nothing, so the result may miss some, never include too many.
+	TSet<FString> GetRequiredPredicates(const FString& Predicate, const TArray<FRuleRequirement>& Rules, TMap<FString, TSet<FString>>& Memo)
+	{
+		if (const TSet<FString>* Required = Memo.Find(Predicate))
+		{
+			return *Required;
+		}
+		Memo.Add(Predicate, { Predicate });
+
+		TSet<FString> Common;
+		bool bDerived = false;
+		for (const FRuleRequirement& Rule : Rules)
+		{
+			if (!Rule.HeadPredicates.Contains(Predicate))
+			{
+				continue;
+			}
+			TSet<FString> RuleRequired;
+			for (const FString& BodyPredicate : Rule.RequiredPredicates)
+			{
+				RuleRequired.Append(GetRequiredPredicates(BodyPredicate, Rules, Memo));
+			}
+			Common = bDerived ? Common.Intersect(RuleRequired) : RuleRequired;
+			bDerived = true;
+		}
+		Common.Add(Predicate);
+		Memo.Add(Predicate, Common);
+		return Common;
+	}
+
+
+	/// Whether every rule that makes a vehicle yield needs an overlap of lanes or forks to the right,
+	/// so that waiting vehicles only yield to vehicles on conflicting lanes or at adjacent forks.
+	bool YieldsOnlyOnConflicts(const TArray<FRuleRequirement>& Rules)
+	{
+		TMap<FString, TSet<FString>> Memo;
+		for (const FRuleRequirement& Rule : Rules)
+		{
+			if (!Rule.HeadPredicates.Contains(TEXT("mustYieldToForRule")))
+			{
+				continue;
+			}
+			TSet<FString> RuleRequired;
+			for (const FString& BodyPredicate : Rule.RequiredPredicates)
+			{
+				RuleRequired.Append(GetRequiredPredicates(BodyPredicate, Rules, Memo));
+			}
+			if (!RuleRequired.Contains(TEXT("overlaps")) && !RuleRequired.Contains(TEXT("isToTheRightOf")))
+			{
+				return false; // E.g. yielding by arrival order
+			}
+		}
+		return true;
+	}
+}
+
+
+TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> FTrafficRules::Get(const FString& RulesFileFullName)
+{
+	FString Key = GetCacheKey(RulesFileFullName);
+	{
+		FScopeLock Lock(&RulesCacheLock);
+		if (TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe>* Cached = RulesCache.Find(Key))
+		{
+			return *Cached;
+		}
+	}
+
+	// Parsed outside of the lock, so that monitors starting together parse their files in parallel.
+	// The first program of a file to be cached wins, so that all monitors share it.
+	TSharedPtr<FTrafficRules, ESPMode::ThreadSafe> Rules = Load(Key);
+	if (!Rules.IsValid())
+	{
+		return nullptr;
+	}
+	FScopeLock Lock(&RulesCacheLock);
+	if (TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe>* Cached = RulesCache.Find(Key))
+	{
+		return *Cached;
+	}
+	RulesCache.Add(Key, Rules);
+	return Rules;
+}
+
+
+TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> FTrafficRules::Reload(const FString& RulesFileFullName, const std::string& ValidationFacts)
+{
+	FString Key = GetCacheKey(RulesFileFullName);
+	TSharedPtr<FTrafficRules, ESPMode::ThreadSafe> Rules = Load(Key);
+	if (!Rules.IsValid())
+	{
+		return nullptr;
+	}
+
+	FDecisionSet Decisions;
+	if (!Rules->Solve(ValidationFacts, Decisions))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Rejected the traffic rules %s: they do not solve with the intersection's geometry!"), *Key);
+		return nullptr;
+	}
+
+	FScopeLock Lock(&RulesCacheLock);
+	RulesCache.Add(Key, Rules);
+	return Rules;
+}
+
+
+FString FTrafficRules::GetCacheKey(const FString& RulesFileFullName)
+{
+	FString Key = FPaths::ConvertRelativePathToFull(RulesFileFullName);
+	FPaths::NormalizeFilename(Key);
+	return Key;
+}
+
+
+TSharedPtr<FTrafficRules, ESPMode::ThreadSafe> FTrafficRules::Load(const FString& Key)
+{
+	std::ifstream RulesFile(TCHAR_TO_UTF8(*Key));
+	if (!RulesFile.is_open())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to open the traffic rules file %s!"), *Key);
+		return nullptr;
+	}
+	std::stringstream buffer;
+	buffer << RulesFile.rdbuf();
+	RulesFile.close();
+
+	TSharedPtr<FTrafficRules, ESPMode::ThreadSafe> Rules = MakeShareable(new FTrafficRules(Key, buffer.str()));
+	if (!Rules->Parse())
+	{
+		return nullptr;
+	}
+	Rules->SolverConfig.Load(FSolverConfig::GetFileFullName(Key));
+
+	UE_LOG(LogTemp, Log, TEXT("Loaded traffic rules %s (%d statements), solved with %s options."),
+		*Key, static_cast<int32>(Rules->ParsedProgram->Statements.size()), *Rules->SolverConfig.ToString());
+	return Rules;
+}
+
+
+bool FSolverConfig::Load(const FString& FileFullName)
+{
+	Arguments.Empty();
+	FString Text;
+	if (!FFileHelper::LoadFileToString(Text, *FileFullName))
+	{
+		return false;
+	}
+	TArray<FString> Lines;
+	Text.ParseIntoArrayLines(Lines);
+	for (const FString& Line : Lines)
+	{
+		FString Argument = Line.TrimStartAndEnd();
+		if (!Argument.IsEmpty() && !Argument.StartsWith(TEXT("%")))
+		{
+			Arguments.Add(Argument);
+		}
+	}
+	return true;
+}
+
+
+bool FSolverConfig::Save(const FString& FileFullName, const FString& Comment) const
+{
+	FString Text;
+	TArray<FString> CommentLines;
+	Comment.ParseIntoArrayLines(CommentLines, false);
+	for (const FString& Line : CommentLines)
+	{
+		Text += "% " + Line + "\n";
+	}
+	for (const FString& Argument : Arguments)
+	{
+		Text += Argument + "\n";
+	}
+	return FFileHelper::SaveStringToFile(Text, *FileFullName);
+}
+
+
+FString FSolverConfig::ToString() const
+{
+	return Arguments.Num() > 0 ? FString::Join(Arguments, TEXT(" ")) : FString(TEXT("default"));
+}
+
+
+const TArray<FString>& FTrafficRules::GetDecisionPredicates()
+{
+	static const TArray<FString> DecisionPredicates = { TEXT("mustYieldToForRule"), TEXT("hasRightOfWay") };
+	return DecisionPredicates;
+}
+
+
+const TArray<FString>& FTrafficRules::GetDecisionSignatures()
+{
+	static const TArray<FString> DecisionSignatures = { TEXT("mustYieldToForRule/3"), TEXT("hasRightOfWay/1") };
+	return DecisionSignatures;
+}
+
+
+FString FTrafficRules::GetRulesFileFullName(const FString& RulesFileName)
+{
+	return FPaths::ProjectSavedDir() + "../Plugins/TrafficMonitor/LogicSolver/" + RulesFileName;
+}
+
+
+FTrafficRules::FTrafficRules(const FString& InFileFullName, std::string&& InSource)
+	: FileFullName(InFileFullName)
+	, Source(MoveTemp(InSource))
+	, ParsedProgram(MakeUnique<FParsedProgram>())
+{
+}
+
+
+FTrafficRules::~FTrafficRules()
+{
+}
+
+
+bool FTrafficRules::Parse()
+{
+	// Only the decision atoms are needed from the models, whatever the file shows
+	std::string DecisionShows;
+	for (const FString& Signature : GetDecisionSignatures())
+	{
+		DecisionShows += "#show " + std::string(TCHAR_TO_UTF8(*Signature)) + ".\n";
+	}
+
+	// The predicate dependency graph, from the rules' heads to their bodies
+	TMap<FString, TSet<FString>> Dependencies;
+	TMap<FString, TSet<FString>> NegativeDependencies; // To the default-negated body predicates only
+	TArray<FRuleRequirement> Requirements;
+	bHasUniqueModel = true;
+
+	try {
+		Clingo::parse_program(Source.c_str(), [this, &Dependencies, &NegativeDependencies, &Requirements](Clingo::AST::Statement const &Statement) {
+			if (Statement.data.is<Clingo::AST::Rule>())
+			{
+				const Clingo::AST::Rule& Rule = Statement.data.get<Clingo::AST::Rule>();
+				TSet<FString> HeadPredicates;
+				TSet<FString> BodyPredicates;
+				TSet<FString> NegatedBodyPredicates;
+				FRuleRequirement Requirement;
+
+				// Choice rules and disjunctions can have several answer sets
+				bHasUniqueModel &= AddHeadPredicates(Rule.head, HeadPredicates, BodyPredicates, NegatedBodyPredicates);
+				for (const Clingo::AST::BodyLiteral& Literal : Rule.body)
+				{
+					bHasUniqueModel &= AddBodyPredicates(Literal, BodyPredicates, NegatedBodyPredicates);
+					AddRequiredPredicate(Literal, Requirement.RequiredPredicates);
+				}
+				for (const FString& HeadPredicate : HeadPredicates)
+				{
+					Dependencies.FindOrAdd(HeadPredicate).Append(BodyPredicates);
+					NegativeDependencies.FindOrAdd(HeadPredicate).Append(NegatedBodyPredicates);
+				}
+				Requirement.HeadPredicates = MoveTemp(HeadPredicates);
+				Requirements.Add(MoveTemp(Requirement));
+			}
+			else if (Statement.data.is<Clingo::AST::External>())
+			{
+				// Free unless assigned, so an external atom can go either way
+				const Clingo::AST::External& External = Statement.data.get<Clingo::AST::External>();
+				TSet<FString> HeadPredicates;
+				TSet<FString> BodyPredicates;
+				TSet<FString> NegatedBodyPredicates;
+				AddAtomPredicate(External.atom, HeadPredicates);
+				for (const Clingo::AST::BodyLiteral& Literal : External.body)
+				{
+					bHasUniqueModel &= AddBodyPredicates(Literal, BodyPredicates, NegatedBodyPredicates);
+				}
+				for (const FString& HeadPredicate : HeadPredicates)
+				{
+					Dependencies.FindOrAdd(HeadPredicate).Append(BodyPredicates);
+					NegativeDependencies.FindOrAdd(HeadPredicate).Append(NegatedBodyPredicates);
+				}
+				Requirements.Add({ MoveTemp(HeadPredicates), {} }); // Can be assigned true without its body
+				bHasUniqueModel = false;
+			}
+			else if (!Statement.data.is<Clingo::AST::Definition>() && !Statement.data.is<Clingo::AST::Program>()
+				&& !Statement.data.is<Clingo::AST::ShowSignature>() && !Statement.data.is<Clingo::AST::ShowTerm>())
+			{
+				// Optimization statements, scripts, heuristics and the like: the first model may not be the answer
+				bHasUniqueModel = false;
+			}
+			if (!Statement.data.is<Clingo::AST::ShowSignature>() && !Statement.data.is<Clingo::AST::ShowTerm>())
+			{
+				ParsedProgram->Statements.push_back(Statement);
+			}
+		});
+		Clingo::parse_program(DecisionShows.c_str(), [this](Clingo::AST::Statement const &Statement) {
+			ParsedProgram->Statements.push_back(Statement);
+		});
+	}
+	catch (std::exception const &e) {
+		UE_LOG(LogTemp, Error, TEXT("Failed to parse the traffic rules %s: %s"), *FileFullName, ANSI_TO_TCHAR(e.what()));
+		return false;
+	}
+
+	// E.g. offline checking rules like all-way-stop.cl: every solve would return no decisions
+	bool bDerivesDecisions = false;
+	for (const FString& Predicate : GetDecisionPredicates())
+	{
+		bDerivesDecisions |= Dependencies.Contains(Predicate);
+	}
+	if (!bDerivesDecisions)
+	{
+		UE_LOG(LogTemp, Error, TEXT("The traffic rules %s derive none of %s."), *FileFullName, *FString::Join(GetDecisionSignatures(), TEXT(", ")));
+		return false;
+	}
+
+	AnalyzeDependencies(Dependencies, NegativeDependencies);
+	bYieldsOnlyOnConflicts = YieldsOnlyOnConflicts(Requirements);
+	return true;
+}
+
+
+/// Checks that the program is stratified and
+/// collects every predicate reachable from the decision predicates.
+void FTrafficRules::AnalyzeDependencies(const TMap<FString, TSet<FString>>& Dependencies, const TMap<FString, TSet<FString>>& NegativeDependencies)
+{
+	// Negation through recursion, i.e. an unstratified program, can have several answer sets too
+	auto DependsOn = [&Dependencies](const FString& From, const FString& To) {
+		TSet<FString> Visited;
+		TArray<FString> Pending = { From };
+		while (Pending.Num() > 0)
+		{
+			FString Predicate = Pending.Pop();
+			if (Predicate == To)
+			{
+				return true;
+			}
+			if (Visited.Contains(Predicate))
+			{
+				continue;
+			}
+			Visited.Add(Predicate);
+			if (const TSet<FString>* BodyPredicates = Dependencies.Find(Predicate))
+			{
+				Pending.Append(BodyPredicates->Array());
+			}
+		}
+		return false;
+	};
+	for (const auto& HeadAndNegated : NegativeDependencies)
+	{
+		for (const FString& Negated : HeadAndNegated.Value)
+		{
+			if (DependsOn(Negated, HeadAndNegated.Key))
+			{
+				UE_LOG(LogTemp, Log, TEXT("%s is not stratified (%s through not %s), computing cautious consequences."),
+					*FileFullName, *HeadAndNegated.Key, *Negated);
+				bHasUniqueModel = false;
+			}
+		}
+	}
+
+	TArray<FString> Pending = GetDecisionPredicates();
+	while (Pending.Num() > 0)
+	{
+		FString Predicate = Pending.Pop();
+		if (DecisionInputs.Contains(Predicate))
+		{
+			continue;
+		}
+		DecisionInputs.Add(Predicate);
+		if (const TSet<FString>* BodyPredicates = Dependencies.Find(Predicate))
+		{
+			Pending.Append(BodyPredicates->Array());
+		}
+	}
+}
+
+
+void FTrafficRules::AddToControl(Clingo::Control& Control) const
+{
+	Control.with_builder([this](Clingo::ProgramBuilder &Builder) {
+		for (Clingo::AST::Statement const &Statement : ParsedProgram->Statements)
+		{
+			Builder.add(Statement);
+		}
+	});
+}
+
+
+bool FTrafficRules::Solve(const std::string& Facts, FDecisionSet& OutDecisions, size_t* OutNumGroundAtoms) const
+{
+	return Solve(SolverConfig, Facts, OutDecisions, OutNumGroundAtoms);
+}
+
+
+bool FTrafficRules::Solve(const FSolverConfig& Config, const std::string& Facts, FDecisionSet& OutDecisions, size_t* OutNumGroundAtoms) const
+{
+	try {
+		// A unique answer set is found by the first model. Otherwise, every model of the cautious
+		// enumeration is the intersection of the answer sets found so far, and the last one is the answer.
+		std::vector<std::string> Options;
+		if (!bHasUniqueModel)
+		{
+			Options = { "--enum-mode=cautious", "--models=0" };
+		}
+		for (const FString& Argument : Config.Arguments)
+		{
+			Options.push_back(TCHAR_TO_UTF8(*Argument));
+		}
+		std::vector<char const *> Arguments;
+		for (const std::string& Option : Options)
+		{
+			Arguments.push_back(Option.c_str());
+		}
+		Clingo::Control ctl{ Clingo::StringSpan{ Arguments.data(), Arguments.size() }, [](Clingo::WarningCode, char const *) {}, 20 };
+
+		ctl.add("base", {}, Facts.c_str());
+		AddToControl(ctl);
+		ctl.ground({ {"base", {}} });
+		if (OutNumGroundAtoms != nullptr)
+		{
+			*OutNumGroundAtoms = ctl.symbolic_atoms().size();
+		}
+
+		// Only the decision atoms are shown
+		auto solveHandle = ctl.solve();
+		for (auto &model : solveHandle) {
+			OutDecisions = FDecisionSet();
+			for (auto &atom : model.symbols(Clingo::ShowType::Shown)) {
+				if (atom.match("mustYieldToForRule", 3))
+				{
+					OutDecisions.MustYield.Add({
+						FString(atom.arguments()[0].name()),
+						FString(atom.arguments()[1].name()),
+						FString(atom.arguments()[2].name()) });
+				}
+				else if (atom.match("hasRightOfWay", 1))
+				{
+					OutDecisions.RightOfWay.Add(FString(atom.arguments()[0].name()));
+				}
+			}
+		}
+		auto solveResult = solveHandle.get();
+		if (solveResult.is_unsatisfiable())
+		{
+			UE_LOG(LogTemp, Error, TEXT("Not satisfiable! (%s)"), *FileFullName);
+			return false;
+		}
+		if (solveResult.is_unknown())
+		{
+			UE_LOG(LogTemp, Error, TEXT("Satisfiability is unknown! (%s)"), *FileFullName);
+			return false;
+		}
+	}
+	catch (std::exception const &e) {
+		UE_LOG(LogTemp, Warning, TEXT("Clingo failed with: %s"), ANSI_TO_TCHAR(e.what()));
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "TrafficRulesFuzzCommandlet.h"
+#include "Async/ParallelFor.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Misc/ScopeLock.h"
+#include "Runtime/Core/Public/Misc/FileHelper.h"
+#include "Runtime/Core/Public/Misc/Paths.h"
+
+// Developer
+#include "RulesFuzzer.h"
+
+
+UTrafficRulesFuzzCommandlet::UTrafficRulesFuzzCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+
+int32 UTrafficRulesFuzzCommandlet::Main(const FString& Params)
+{
+	FString GeometryFile;
+	FString RulesFile = TEXT("all-way-stop_new.cl");
+	int32 NumScenarios = 10000;
+	int32 MaxVehicles = 6;
+	int32 Seed = 0;
+	int32 NumReproducers = 5; // Per kind of failure
+	FParse::Value(*Params, TEXT("Geometry="), GeometryFile);
+	FParse::Value(*Params, TEXT("Rules="), RulesFile);
+	FParse::Value(*Params, TEXT("Scenarios="), NumScenarios);
+	FParse::Value(*Params, TEXT("MaxVehicles="), MaxVehicles);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Reproducers="), NumReproducers);
+
+	FFuzzGeometry Geometry;
+	if (GeometryFile.IsEmpty() || !Geometry.Load(FPaths::ProjectSavedDir() + GeometryFile))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Cannot read the lanes of the geometry file \"%s\"!"), *GeometryFile);
+		return 1;
+	}
+	TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> Rules = FTrafficRules::Get(FTrafficRules::GetRulesFileFullName(RulesFile));
+	if (!Rules.IsValid())
+	{
+		return 1;
+	}
+	FRulesFuzzer Fuzzer(Rules, Geometry, MaxVehicles);
+
+	FFuzzScenario YieldToInside = Fuzzer.MakeYieldToInsideScenario();
+	if (YieldToInside.Events.Num() > 0 && Fuzzer.Check(YieldToInside) == EFuzzFailure::Deadlock)
+	{
+		UE_LOG(LogTemp, Error, TEXT("A vehicle waiting for one inside the intersection is taken for a deadlock:\n%s"),
+			UTF8_TO_TCHAR(Fuzzer.ToProgram(YieldToInside).c_str()));
+		return 1;
+	}
+
+	// Every scenario has its own seed, so that any of them can be generated again
+	constexpr int32 NumFailureKinds = 4;
+	FThreadSafeCounter NumFailures[NumFailureKinds];
+	FCriticalSection FailuresLock;
+	TArray<TPair<int32, FFuzzScenario>> Failures[NumFailureKinds];
+
+	double StartTime = FPlatformTime::Seconds();
+	ParallelFor(NumScenarios, [&](int32 Index) {
+		FRandomStream Random(Seed + Index);
+		FFuzzScenario Scenario = Fuzzer.Generate(Random);
+		EFuzzFailure Failure = Fuzzer.Check(Scenario);
+		if (Failure == EFuzzFailure::None)
+		{
+			return;
+		}
+		int32 Kind = static_cast<int32>(Failure);
+		if (NumFailures[Kind].Increment() <= NumReproducers)
+		{
+			FScopeLock Lock(&FailuresLock);
+			Failures[Kind].Emplace(Index, MoveTemp(Scenario));
+		}
+	});
+	double Seconds = FPlatformTime::Seconds() - StartTime;
+
+	UE_LOG(LogTemp, Display, TEXT("Fuzzed %s with %d scenarios in %.1f s: %.1f scenarios/s."),
+		*RulesFile, NumScenarios, Seconds, NumScenarios / FMath::Max(Seconds, 1e-3));
+
+	// Shrink the kept failures, in parallel too
+	TArray<TPair<EFuzzFailure, TPair<int32, FFuzzScenario>>> ToMinimize;
+	for (int32 Kind = 1; Kind < NumFailureKinds; Kind++)
+	{
+		UE_LOG(LogTemp, Display, TEXT("  %s: %d"), FRulesFuzzer::ToString(static_cast<EFuzzFailure>(Kind)), NumFailures[Kind].GetValue());
+		for (const TPair<int32, FFuzzScenario>& Failure : Failures[Kind])
+		{
+			ToMinimize.Emplace(static_cast<EFuzzFailure>(Kind), Failure);
+		}
+	}
+	FString OutputDirectory = FPaths::ProjectSavedDir() + TEXT("RulesFuzzer/");
+	ParallelFor(ToMinimize.Num(), [&](int32 i) {
+		EFuzzFailure Failure = ToMinimize[i].Key;
+		int32 Index = ToMinimize[i].Value.Key;
+		FFuzzScenario Minimized = Fuzzer.Minimize(ToMinimize[i].Value.Value, Failure);
+		FString Reproducer = FString::Printf(TEXT("%% %s with %s, scenario %d of seed %d, %d of %d events kept.\n"),
+			FRulesFuzzer::ToString(Failure), *RulesFile, Index, Seed, Minimized.Events.Num(), ToMinimize[i].Value.Value.Events.Num());
+		Reproducer += UTF8_TO_TCHAR(Fuzzer.ToProgram(Minimized).c_str());
+		FString FileName = OutputDirectory + FString::Printf(TEXT("%s_%d.cl"), FRulesFuzzer::ToString(Failure), Index);
+		FFileHelper::SaveStringToFile(Reproducer, *FileName);
+	});
+	if (ToMinimize.Num() > 0)
+	{
+		UE_LOG(LogTemp, Display, TEXT("Wrote %d minimized reproducers to %s"), ToMinimize.Num(), *OutputDirectory);
+	}
+	return 0;
+}
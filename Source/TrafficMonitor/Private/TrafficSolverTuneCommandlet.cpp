@@ -0,0 +1,170 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "TrafficSolverTuneCommandlet.h"
+#include "HAL/FileManager.h"
+#include "Runtime/Core/Public/Misc/FileHelper.h"
+#include "Runtime/Core/Public/Misc/Paths.h"
+
+// Developer
+#include "SolverTuner.h"
+
+
+UTrafficSolverTuneCommandlet::UTrafficSolverTuneCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+
+int32 UTrafficSolverTuneCommandlet::Main(const FString& Params)
+{
+	FString RulesFile = TEXT("all-way-stop_new.cl");
+	FString Traces = TEXT("Analytics/");
+	FString Configurations = TEXT("auto,frumpy,jumpy,tweety,handy,crafty,trendy");
+	FString Heuristics = TEXT("default,Berkmin,Vmtf,Vsids");
+	FString Threads = TEXT("1,2");
+	FString Metric = TEXT("p95");
+	int32 MaxScenarios = 1000;
+	int32 NumRepeats = 3;
+	FParse::Value(*Params, TEXT("Rules="), RulesFile);
+	FParse::Value(*Params, TEXT("Traces="), Traces);
+	FParse::Value(*Params, TEXT("Configurations="), Configurations);
+	FParse::Value(*Params, TEXT("Heuristics="), Heuristics);
+	FParse::Value(*Params, TEXT("Threads="), Threads);
+	FParse::Value(*Params, TEXT("Metric="), Metric);
+	FParse::Value(*Params, TEXT("MaxScenarios="), MaxScenarios);
+	FParse::Value(*Params, TEXT("Repeats="), NumRepeats);
+	bool bDryRun = FParse::Param(*Params, TEXT("DryRun"));
+
+	FString RulesFileFullName = FTrafficRules::GetRulesFileFullName(RulesFile);
+	TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> Rules = FTrafficRules::Get(RulesFileFullName);
+	if (!Rules.IsValid())
+	{
+		return 1;
+	}
+
+	// Replay what the rules are written against, e.g. the vehicle states for all-way-stop_hybrid.cl
+	FString Error;
+	bool bHybridState = FSolverTuner::NeedsHybridState(*Rules, Error);
+	if (!Error.IsEmpty())
+	{
+		UE_LOG(LogTemp, Error, TEXT("%s!"), *Error);
+		return 1;
+	}
+
+	// "Analytics/" or "Analytics/Monitor_20200101_120000.tmal,..."
+	TArray<FString> TraceFiles;
+	TArray<FString> TracePaths;
+	Traces.ParseIntoArray(TracePaths, TEXT(","));
+	for (const FString& TracePath : TracePaths)
+	{
+		FString FullPath = FPaths::ProjectSavedDir() + TracePath;
+		if (IFileManager::Get().DirectoryExists(*FullPath))
+		{
+			TArray<FString> Found;
+			IFileManager::Get().FindFiles(Found, *(FullPath / TEXT("*.tmal")), true, false);
+			for (const FString& File : Found)
+			{
+				TraceFiles.Add(FullPath / File);
+			}
+		}
+		else
+		{
+			TraceFiles.Add(FullPath);
+		}
+	}
+
+	FSolverTuner Tuner;
+	for (const FString& TraceFile : TraceFiles)
+	{
+		// Traces are named <Monitor>_<yyyymmdd>_<hhmmss>.tmal
+		FString Monitor = FPaths::GetBaseFilename(TraceFile);
+		for (int32 Part = 0; Part < 2; Part++)
+		{
+			int32 Separator;
+			if (Monitor.FindLastChar('_', Separator))
+			{
+				Monitor = Monitor.Left(Separator);
+			}
+		}
+		FString Geometry;
+		FAnalyticsTables Trace;
+		if (!FFileHelper::LoadFileToString(Geometry, *(FPaths::ProjectSavedDir() + Monitor + TEXT("Geometry.cl"))))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Skipped %s: no geometry file of %s."), *TraceFile, *Monitor);
+			continue;
+		}
+		if (!FAnalyticsLog::Read(TraceFile, Trace))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Skipped %s: not an analytics trace."), *TraceFile);
+			continue;
+		}
+		int32 NumAdded = Tuner.AddTrace(Trace, std::string(TCHAR_TO_UTF8(*Geometry)), bHybridState);
+		UE_LOG(LogTemp, Display, TEXT("%s: %d event sets."), *TraceFile, NumAdded);
+	}
+	Tuner.Sample(MaxScenarios);
+	if (Tuner.Num() == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("No event sets to replay in \"%s\"!"), *Traces);
+		return 1;
+	}
+
+	TArray<FString> ConfigurationNames;
+	TArray<FString> HeuristicNames;
+	TArray<FString> ThreadCounts;
+	Configurations.ParseIntoArray(ConfigurationNames, TEXT(","));
+	Heuristics.ParseIntoArray(HeuristicNames, TEXT(","));
+	Threads.ParseIntoArray(ThreadCounts, TEXT(","));
+	TArray<int32> NumThreads;
+	for (const FString& Count : ThreadCounts)
+	{
+		NumThreads.Add(FMath::Max(1, FCString::Atoi(*Count)));
+	}
+
+	// One configuration at a time, so that they do not compete for the cores
+	TArray<TSet<FString>> ReferenceDecisions;
+	FSolverConfig Baseline;
+	FSolverLatencies BaselineLatencies = Tuner.Measure(*Rules, Baseline, NumRepeats, ReferenceDecisions);
+	auto LogLatencies = [](const FSolverConfig& Config, const FSolverLatencies& Latencies) {
+		UE_LOG(LogTemp, Display, TEXT("  %s: mean %.3f, p50 %.3f, p95 %.3f, p99 %.3f, max %.3f ms, %d failures, %d mismatches"),
+			*Config.ToString(), Latencies.Mean, Latencies.P50, Latencies.P95, Latencies.P99, Latencies.Max,
+			Latencies.NumFailures, Latencies.NumMismatches);
+	};
+	UE_LOG(LogTemp, Display, TEXT("Replaying %d event sets with %s, best of %d runs each:"), Tuner.Num(), *RulesFile, NumRepeats);
+	LogLatencies(Baseline, BaselineLatencies);
+
+	FSolverConfig Best = Baseline;
+	FSolverLatencies BestLatencies = BaselineLatencies;
+	for (const FSolverConfig& Config : FSolverTuner::MakeGrid(ConfigurationNames, HeuristicNames, NumThreads))
+	{
+		FSolverLatencies Latencies = Tuner.Measure(*Rules, Config, NumRepeats, ReferenceDecisions);
+		LogLatencies(Config, Latencies);
+
+		// Options must not change the decisions, e.g. through a time limit
+		if (Latencies.NumFailures <= BaselineLatencies.NumFailures && Latencies.NumMismatches == 0
+			&& Latencies.Get(Metric) < BestLatencies.Get(Metric))
+		{
+			Best = Config;
+			BestLatencies = Latencies;
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Best %s: %s, %.3f ms (default options %.3f ms)."),
+		*Metric, *Best.ToString(), BestLatencies.Get(Metric), BaselineLatencies.Get(Metric));
+	if (bDryRun)
+	{
+		return 0;
+	}
+	FString ConfigFileFullName = FSolverConfig::GetFileFullName(RulesFileFullName);
+	FString Comment = FString::Printf(TEXT("Solver options of %s, written by the TrafficSolverTune commandlet on %s.\n%s latency %.3f ms over %d event sets (default options %.3f ms)."),
+		*RulesFile, *FDateTime::Now().ToString(), *Metric, BestLatencies.Get(Metric), Tuner.Num(), BaselineLatencies.Get(Metric));
+	if (!Best.Save(ConfigFileFullName, Comment))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to write %s!"), *ConfigFileFullName);
+		return 1;
+	}
+	UE_LOG(LogTemp, Display, TEXT("Wrote %s"), *ConfigFileFullName);
+	return 0;
+}
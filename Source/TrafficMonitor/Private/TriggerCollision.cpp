@@ -0,0 +1,76 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "TriggerCollision.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "EngineUtils.h"
+#include "GameFramework/Actor.h"
+
+
+const FName TriggerCollision::ProfileName(TEXT("TrafficMonitorTrigger"));
+
+
+void TriggerCollision::SetupTrigger(UPrimitiveComponent* Trigger)
+{
+	FCollisionResponseTemplate Template;
+	if (UCollisionProfile::Get()->GetProfileTemplate(ProfileName, Template))
+	{
+		Trigger->SetCollisionProfileName(ProfileName);
+	}
+	else
+	{
+		Trigger->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+		Trigger->SetCollisionObjectType(ECC_WorldDynamic);
+		Trigger->SetCollisionResponseToAllChannels(ECR_Ignore);
+		Trigger->SetCollisionResponseToChannel(ECC_Vehicle, ECR_Overlap);
+	}
+	Trigger->SetGenerateOverlapEvents(true);
+}
+
+
+bool TriggerCollision::TriggersOverlap(const AActor* A, const AActor* B)
+{
+	if (A == nullptr || B == nullptr || A == B || !A->GetComponentsBoundingBox().Intersect(B->GetComponentsBoundingBox()))
+	{
+		return false;
+	}
+	TInlineComponentArray<UPrimitiveComponent*> TriggersA;
+	TInlineComponentArray<UPrimitiveComponent*> TriggersB;
+	A->GetComponents(TriggersA);
+	B->GetComponents(TriggersB);
+	for (UPrimitiveComponent* TriggerA : TriggersA)
+	{
+		if (!TriggerA->GetGenerateOverlapEvents() || !TriggerA->IsQueryCollisionEnabled())
+		{
+			continue;
+		}
+		for (UPrimitiveComponent* TriggerB : TriggersB)
+		{
+			if (TriggerB->GetGenerateOverlapEvents() && TriggerB->IsQueryCollisionEnabled()
+				&& TriggerA->Bounds.GetBox().Intersect(TriggerB->Bounds.GetBox())
+				&& TriggerA->ComponentOverlapComponent(TriggerB, TriggerA->GetComponentLocation(), TriggerA->GetComponentQuat(), FCollisionQueryParams()))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+
+void TriggerCollision::GetOverlappingTriggerActors(const AActor* Actor, TSubclassOf<AActor> Class, TArray<AActor*>& OutActors)
+{
+	OutActors.Empty();
+	UWorld* World = Actor != nullptr ? Actor->GetWorld() : nullptr;
+	if (World == nullptr)
+	{
+		return;
+	}
+	for (TActorIterator<AActor> It(World, Class); It; ++It)
+	{
+		if (TriggersOverlap(Actor, *It))
+		{
+			OutActors.Add(*It);
+		}
+	}
+}
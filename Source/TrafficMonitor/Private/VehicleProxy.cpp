@@ -0,0 +1,152 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "VehicleProxy.h"
+
+// Developer
+#include "Fork.h"
+#include "Lane.h"
+#include "TrafficGenerator.h"
+
+
+AVehicleProxy::AVehicleProxy(const FObjectInitializer &ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	Body = CreateDefaultSubobject<UBoxComponent>(TEXT("Body"));
+	Body->SetBoxExtent(FVector{ 225.f, 90.f, 75.f });
+	Body->SetHiddenInGame(false);
+	Body->ShapeColor = FColor(255, 255, 0);
+	Body->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	Body->SetCollisionObjectType(ECC_Vehicle);
+	Body->SetCollisionResponseToAllChannels(ECR_Overlap);
+	Body->SetGenerateOverlapEvents(true);
+	RootComponent = Body;
+
+	// Only evaluated, by this actor's tick
+	SpeedProfile = CreateDefaultSubobject<UDistanceTimeCurve>(TEXT("SpeedProfile"));
+	SpeedProfile->PrimaryComponentTick.bCanEverTick = false;
+}
+
+
+void AVehicleProxy::Init(ATrafficGenerator* InGenerator, ALane* InLane, AVehicleProxy* InLeader, float InApproachLength, float InDepartureLength, float Speed)
+{
+	Generator = InGenerator;
+	Lane = InLane;
+	Leader = InLeader;
+	Signal = Lane->GetCorrectSignal();
+	ApproachLength = InApproachLength;
+	LaneLength = Lane->Spline->GetSplineLength();
+	TotalLength = ApproachLength + LaneLength + InDepartureLength;
+
+	// Constant speed; the stops are left to the yield decisions and the queues
+	SpeedProfile->AddKey(0.f, 0.f);
+	SpeedProfile->AddKey(TotalLength / Speed, TotalLength);
+
+	SpawnTime = GetWorld()->GetTimeSeconds();
+	FVector Direction;
+	SetActorLocationAndRotation(GetLocationAtDistance(0.f, Direction), Direction.Rotation());
+}
+
+
+void AVehicleProxy::SetMayProceed(bool bInMayProceed)
+{
+	float Now = GetWorld()->GetTimeSeconds();
+	if (ArrivalTime < 0.f)
+	{
+		ArrivalTime = Now; // Decided upon within the arrival overlap
+	}
+	if (FirstDecisionTime < 0.f)
+	{
+		FirstDecisionTime = Now;
+	}
+	if (bInMayProceed && ProceedTime < 0.f)
+	{
+		ProceedTime = Now;
+	}
+	bMayProceed = bInMayProceed;
+}
+
+
+void AVehicleProxy::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (Lane == nullptr || Generator == nullptr)
+	{
+		return;
+	}
+
+	float Now = GetWorld()->GetTimeSeconds();
+	if (ArrivalTime < 0.f && Lane->MyFork->ArrivalTriggerVolume->IsOverlappingActor(this))
+	{
+		ArrivalTime = Now;
+	}
+
+	if (!bMayProceed && ArrivalTime >= 0.f && Now - ArrivalTime > Generator->MaxWaitSeconds)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("%s waited %.1f seconds for the right of way, proceeding!"), *GetName(), Now - ArrivalTime);
+		bMayProceed = true;
+		Generator->NumTimedOut++;
+	}
+
+	// The front of the body stops at the fork, and behind the leader while it has not cleared the fork
+	float Length = 2.f * Body->GetScaledBoxExtent().X;
+	float StopLine = ApproachLength - Length / 2.f;
+	float Limit = TotalLength;
+	if (!bMayProceed && Distance <= StopLine)
+	{
+		Limit = StopLine;
+	}
+	if (Leader.IsValid())
+	{
+		float LeaderDistance = Leader->GetDistance() - Leader->GetApproachLength() + ApproachLength;
+		if (LeaderDistance - ApproachLength < MinimumGap + Length)
+		{
+			Limit = FMath::Min(Limit, LeaderDistance - MinimumGap - Length);
+		}
+		else
+		{
+			Leader.Reset();
+		}
+	}
+
+	// The profile pauses while the proxy is held back, and resumes from there
+	float NextDistance = SpeedProfile->Eval(ProfileTime + DeltaTime);
+	if (NextDistance <= Limit)
+	{
+		ProfileTime += DeltaTime;
+		Distance = NextDistance;
+	}
+	else
+	{
+		Distance = FMath::Max(Distance, Limit);
+	}
+
+	FVector Direction;
+	SetActorLocationAndRotation(GetLocationAtDistance(Distance, Direction), Direction.Rotation());
+
+	if (Distance >= TotalLength)
+	{
+		Generator->RecordTrip(SpawnTime, ArrivalTime, FirstDecisionTime, ProceedTime, Now);
+		Destroy();
+	}
+}
+
+
+FVector AVehicleProxy::GetLocationAtDistance(float InDistance, FVector& OutDirection) const
+{
+	if (InDistance < ApproachLength)
+	{
+		OutDirection = Lane->MyFork->GetActorForwardVector();
+		return Lane->MyFork->GetActorLocation() - OutDirection * (ApproachLength - InDistance);
+	}
+	if (InDistance < ApproachLength + LaneLength)
+	{
+		float DistanceAlongLane = InDistance - ApproachLength;
+		OutDirection = Lane->Spline->GetDirectionAtDistanceAlongSpline(DistanceAlongLane, ESplineCoordinateSpace::World);
+		return Lane->Spline->GetLocationAtDistanceAlongSpline(DistanceAlongLane, ESplineCoordinateSpace::World);
+	}
+	OutDirection = Lane->MyExit->GetActorForwardVector();
+	return Lane->MyExit->GetActorLocation() + OutDirection * (InDistance - ApproachLength - LaneLength);
+}
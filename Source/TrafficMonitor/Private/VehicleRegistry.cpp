@@ -0,0 +1,118 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "VehicleRegistry.h"
+#include "GameFramework/Pawn.h"
+
+// Carla
+#include "Vehicle/CarlaWheeledVehicle.h"
+#include "Vehicle/WheeledVehicleAIController.h"
+
+// Developer
+#include "VehicleProxy.h"
+
+
+int32 UVehicleRegistry::Acquire(AActor* Vehicle)
+{
+	int32 Id = Find(Vehicle);
+	if (Id == INDEX_NONE)
+	{
+		Id = FreeIds.Num() > 0 ? FreeIds.Pop(false) : Vehicles.AddDefaulted();
+		FRegisteredVehicle& Registered = Vehicles[Id];
+		Registered = FRegisteredVehicle();
+		Registered.Actor = Vehicle;
+		Registered.Key = FObjectKey(Vehicle);
+		Registered.CarlaVehicle = Cast<ACarlaWheeledVehicle>(Vehicle);
+		Registered.Proxy = Cast<AVehicleProxy>(Vehicle);
+		Registered.Name = Vehicle->GetName();
+		Registered.Atom = "v_" + Registered.Name;
+		Ids.Add(Registered.Key, Id);
+
+		// A new actor may reuse the name of one that is destroyed but not released yet
+		const int32* Previous = IdsByAtom.Find(Registered.Atom);
+		if (Previous == nullptr || !Vehicles[*Previous].Actor.IsValid())
+		{
+			IdsByAtom.Add(Registered.Atom, Id);
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Vehicle atom %s is already registered, decisions for it go to the first vehicle."), *Registered.Atom);
+		}
+	}
+	Vehicles[Id].NumMonitors++;
+	return Id;
+}
+
+
+void UVehicleRegistry::Release(int32 Id)
+{
+	FRegisteredVehicle& Registered = Vehicles[Id];
+	if (--Registered.NumMonitors > 0)
+	{
+		return;
+	}
+	Ids.Remove(Registered.Key);
+	if (FindByAtom(Registered.Atom) == Id)
+	{
+		IdsByAtom.Remove(Registered.Atom);
+	}
+	Registered = FRegisteredVehicle();
+	FreeIds.Add(Id);
+}
+
+
+int32 UVehicleRegistry::Find(const AActor* Vehicle) const
+{
+	const int32* Id = Ids.Find(FObjectKey(Vehicle));
+	return Id != nullptr ? *Id : INDEX_NONE;
+}
+
+
+int32 UVehicleRegistry::FindByAtom(const FString& Atom) const
+{
+	const int32* Id = IdsByAtom.Find(Atom);
+	return Id != nullptr ? *Id : INDEX_NONE;
+}
+
+
+bool UVehicleRegistry::GetSignal(int32 Id, FString& OutSignal) const
+{
+	const FRegisteredVehicle& Registered = Vehicles[Id];
+	if (ACarlaWheeledVehicle* CarlaVehicle = Registered.CarlaVehicle.Get())
+	{
+		OutSignal = CarlaVehicle->GetSignalString();
+		return true;
+	}
+	if (AVehicleProxy* Proxy = Registered.Proxy.Get())
+	{
+		OutSignal = Proxy->GetSignalString();
+		return true;
+	}
+	return false;
+}
+
+
+bool UVehicleRegistry::SetMayProceed(int32 Id, bool bMayProceed)
+{
+	FRegisteredVehicle& Registered = Vehicles[Id];
+	if (AVehicleProxy* Proxy = Registered.Proxy.Get())
+	{
+		Proxy->SetMayProceed(bMayProceed);
+		return true;
+	}
+	APawn* Pawn = Cast<APawn>(Registered.Actor.Get());
+	if (Pawn == nullptr)
+	{
+		return false;
+	}
+	if (Registered.Controller.Get() != Pawn->GetController())
+	{
+		Registered.Controller = Cast<AWheeledVehicleAIController>(Pawn->GetController());
+	}
+	AWheeledVehicleAIController* Controller = Registered.Controller.Get();
+	if (Controller == nullptr)
+	{
+		return false;
+	}
+	Controller->SetTrafficLightState(bMayProceed ? ETrafficLightState::Green : ETrafficLightState::Red);
+	return true;
+}
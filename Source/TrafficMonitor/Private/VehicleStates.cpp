@@ -0,0 +1,125 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#include "VehicleStates.h"
+
+
+void FVehicleStates::Apply(const FString& Vehicle, const FMonitorEvent& Event, const FLaneConflictMatrix& Lanes,
+	const TMap<FString, TBitArray<>>& LanesByForkAndSignal)
+{
+	FVehicleState& State = States.FindOrAdd(Vehicle);
+	if (Event.Predicate == "arrivesAtForkAtTime")
+	{
+		State.Fork = Event.Arguments[1];
+		State.ArrivalTimeStep = Event.TimeStep;
+		if (State.Phase == EVehiclePhase::Approaching)
+		{
+			State.Phase = EVehiclePhase::AtFork;
+		}
+	}
+	else if (Event.Predicate == "signalsAtForkAtTime")
+	{
+		const TBitArray<>* ForkLanes = LanesByForkAndSignal.Find(Event.Arguments[2] + "/" + Event.Arguments[1]);
+		State.WantedLanes = ForkLanes != nullptr ? *ForkLanes : Lanes.MakeLaneSet();
+	}
+	else if (Event.Predicate == "entersForkAtTime")
+	{
+		if (State.Phase < EVehiclePhase::Entered)
+		{
+			State.Phase = EVehiclePhase::Entered;
+		}
+	}
+	else if (Event.Predicate == "entersLaneAtTime" || Event.Predicate == "leavesLaneAtTime")
+	{
+		int32 Lane = Lanes.FindLane(Event.Arguments[1]);
+		if (Lane == INDEX_NONE)
+		{
+			return;
+		}
+		bool bEnters = Event.Predicate == "entersLaneAtTime";
+		FLaneConflictMatrix::SetLane(State.OnLanes, Lane, bEnters);
+		if (!bEnters)
+		{
+			FLaneConflictMatrix::SetLane(State.LeftLanes, Lane, true);
+		}
+		// Lanes can overlap the arrival trigger, so a vehicle still waiting keeps its arrival
+		if (State.Phase >= EVehiclePhase::Entered)
+		{
+			State.Phase = State.OnLanes.Find(true) != INDEX_NONE ? EVehiclePhase::OnLane : EVehiclePhase::Left;
+		}
+	}
+}
+
+
+std::string FVehicleStates::GetFacts(const TArray<FString>& Vehicles, const FLaneConflictMatrix& Lanes, bool bNormalize, int32& OutNumTimeSteps) const
+{
+	// Only the waiting vehicles' arrivals are compared, for order and equality
+	TArray<int32> TimeSteps;
+	for (const FString& Vehicle : Vehicles)
+	{
+		const FVehicleState* State = States.Find(Vehicle);
+		if (State != nullptr && State->Phase == EVehiclePhase::AtFork)
+		{
+			TimeSteps.AddUnique(State->ArrivalTimeStep);
+		}
+	}
+	TimeSteps.Sort();
+	OutNumTimeSteps = TimeSteps.Num();
+
+	FString Facts;
+	for (const FString& Vehicle : Vehicles)
+	{
+		const FVehicleState* State = States.Find(Vehicle);
+		if (State == nullptr)
+		{
+			continue;
+		}
+		FString VehicleAtom = "v_" + Vehicle;
+		if (State->ArrivalTimeStep != INDEX_NONE)
+		{
+			Facts += "arrived(" + VehicleAtom + ").\n";
+		}
+		if (State->Phase == EVehiclePhase::AtFork)
+		{
+			int32 Time = bNormalize ? TimeSteps.IndexOfByKey(State->ArrivalTimeStep) : State->ArrivalTimeStep;
+			Facts += FString::Printf(TEXT("waitingAtFork(%s, %s, %d).\n"), *VehicleAtom, *State->Fork, Time);
+			for (TConstSetBitIterator<> It(State->WantedLanes); It; ++It)
+			{
+				Facts += "wantsLane(" + VehicleAtom + ", " + Lanes.GetLane(It.GetIndex()) + ").\n";
+			}
+		}
+
+		// On a lane it wants; the lanes it left matter only then
+		bool bReserves = false;
+		for (TConstSetBitIterator<> It(State->OnLanes); It; ++It)
+		{
+			if (It.GetIndex() < State->WantedLanes.Num() && State->WantedLanes[It.GetIndex()])
+			{
+				Facts += "reservedLane(" + VehicleAtom + ", " + Lanes.GetLane(It.GetIndex()) + ").\n";
+				bReserves = true;
+			}
+		}
+		if (bReserves)
+		{
+			for (TConstSetBitIterator<> It(State->LeftLanes); It; ++It)
+			{
+				Facts += "leftLane(" + VehicleAtom + ", " + Lanes.GetLane(It.GetIndex()) + ").\n";
+			}
+		}
+	}
+	return std::string(TCHAR_TO_ANSI(*Facts));
+}
+
+
+const TArray<FString>& FVehicleStates::GetStatePredicates(const FString& EventPredicate)
+{
+	static const TMap<FString, TArray<FString>> StatePredicates = {
+		{ "arrivesAtForkAtTime", { "arrived", "waitingAtFork" } },
+		{ "signalsAtForkAtTime", { "wantsLane", "reservedLane" } },
+		{ "entersForkAtTime", { "waitingAtFork", "wantsLane" } },
+		{ "entersLaneAtTime", { "reservedLane" } },
+		{ "leavesLaneAtTime", { "reservedLane", "leftLane" } },
+	};
+	static const TArray<FString> None;
+	const TArray<FString>* Found = StatePredicates.Find(EventPredicate);
+	return Found != nullptr ? *Found : None;
+}
@@ -0,0 +1,141 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Curves/RichCurve.h"
+
+// Developer
+#include "MonitorEvent.h"
+#include "TrafficDecisions.h"
+
+/// How the decisions of a solve row were obtained
+enum class EAnalyticsSolve : uint8
+{
+	InProcess,
+	CacheHit,
+	ConflictFree,
+	Service,
+	Component, // One conflict component of a partitioned solve
+};
+
+/// Columns of the event table. String columns hold dictionary indices, INDEX_NONE where absent.
+struct TRAFFICMONITOR_API FAnalyticsEvents
+{
+	TArray<double> Time; // World seconds
+	TArray<int32> TimeStep;
+	TArray<int32> Predicate;
+	TArray<int32> Vehicle;
+	TArray<int32> Argument1;
+	TArray<int32> Argument2;
+
+	int32 Num() const { return Time.Num(); }
+	void Append(const FAnalyticsEvents& Other);
+	void Empty();
+	friend FArchive& operator<<(FArchive& Ar, FAnalyticsEvents& Events);
+};
+
+/// One row per applied decision atom
+struct TRAFFICMONITOR_API FAnalyticsDecisions
+{
+	TArray<double> Time;
+	TArray<int32> Vehicle;
+	TArray<int32> YieldsTo; // INDEX_NONE for a right of way
+	TArray<int32> Rule; // e.g. "firstInFirstOut", INDEX_NONE for a right of way
+
+	int32 Num() const { return Time.Num(); }
+	void Append(const FAnalyticsDecisions& Other);
+	void Empty();
+	friend FArchive& operator<<(FArchive& Ar, FAnalyticsDecisions& Decisions);
+};
+
+struct TRAFFICMONITOR_API FAnalyticsSolves
+{
+	TArray<double> Time;
+	TArray<uint8> Kind; // EAnalyticsSolve
+	TArray<int32> NumVehicles;
+	TArray<int32> NumTimeSteps;
+	TArray<int64> NumGroundAtoms; // 0 unless solved in-process
+	TArray<float> Milliseconds;
+
+	int32 Num() const { return Time.Num(); }
+	void Append(const FAnalyticsSolves& Other);
+	void Empty();
+	friend FArchive& operator<<(FArchive& Ar, FAnalyticsSolves& Solves);
+};
+
+/// One row per kept key of a vehicle's distance along the lane it took, see UDistanceTimeCurve::AddSample
+struct TRAFFICMONITOR_API FAnalyticsTrajectories
+{
+	TArray<int32> Vehicle;
+	TArray<int32> Lane;
+	TArray<double> Time;
+	TArray<float> Distance; // cm along the lane's spline
+
+	int32 Num() const { return Time.Num(); }
+	void Append(const FAnalyticsTrajectories& Other);
+	void Empty();
+	friend FArchive& operator<<(FArchive& Ar, FAnalyticsTrajectories& Trajectories);
+};
+
+/// A whole analytics file, once read.
+struct TRAFFICMONITOR_API FAnalyticsTables
+{
+	TArray<FString> Dictionary;
+	FAnalyticsEvents Events;
+	FAnalyticsDecisions Decisions;
+	FAnalyticsSolves Solves;
+	FAnalyticsTrajectories Trajectories; // Empty in version 1 files
+
+	const FString& GetString(int32 Index) const;
+};
+
+/// Append-only columnar log of a monitor's events, applied decisions and solves, for offline analysis.
+///
+/// File: "TMAL", version, then blocks of one table each:
+///   uint8 table, int32 rows, int32 uncompressed bytes, int32 compressed bytes, zlib payload.
+/// The payload holds the strings added to the dictionary since the previous block, then the table's columns.
+/// Strings are numbered in order of first appearance over the whole file, so blocks are only decodable in order,
+/// and a file cut short by a crash is readable up to its last complete block.
+class TRAFFICMONITOR_API FAnalyticsLog
+{
+public:
+	static constexpr int32 BlockRows = 4096;
+
+	~FAnalyticsLog();
+
+	/// Creates the file, replacing any file of the same name.
+	bool Open(const FString& FileFullName);
+	bool IsOpen() const { return Writer.IsValid(); }
+
+	void AddEvent(double Time, const FMonitorEvent& Event);
+	void AddDecisions(double Time, const FDecisionSet& Decisions);
+	void AddSolve(double Time, EAnalyticsSolve Kind, int32 NumVehicles, int32 NumTimeSteps, int64 NumGroundAtoms, double Seconds);
+	void AddTrajectory(const FString& Vehicle, const FString& Lane, const FRichCurve& Curve);
+
+	/// Writes the buffered rows of every table as blocks.
+	void Flush();
+	void Close();
+
+	static bool Read(const FString& FileFullName, FAnalyticsTables& OutTables);
+
+private:
+	enum ETable : uint8
+	{
+		EventTable,
+		DecisionTable,
+		SolveTable,
+		TrajectoryTable, // Since version 2
+	};
+
+	int32 Encode(const FString& String);
+	void WriteBlock(ETable Table);
+
+	TUniquePtr<FArchive> Writer;
+	TMap<FString, int32> Dictionary;
+	TArray<FString> NewStrings;
+	FAnalyticsEvents Events;
+	FAnalyticsDecisions Decisions;
+	FAnalyticsSolves Solves;
+	FAnalyticsTrajectories Trajectories;
+};
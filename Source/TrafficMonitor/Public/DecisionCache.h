@@ -0,0 +1,43 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/LruCache.h"
+
+// Developer
+#include "MonitorEvent.h"
+#include "TrafficDecisions.h"
+
+// STL
+#include <string>
+
+/// Least recently used cache of decision sets, keyed by a canonical form of the event set.
+///
+/// The canonical form replaces time steps by their ranks, vehicles by their position in the
+/// sorted list of per-vehicle event signatures, and takes the smallest such form over the fork
+/// rotations that map the intersection geometry onto itself.
+/// Decisions only name vehicles, so they are stored by canonical vehicle index.
+class TRAFFICMONITOR_API FDecisionCache
+{
+public:
+	void Reset(int32 InCapacity);
+
+	/// Finds the rotations of the forks (given in counterclockwise order) that preserve every geometry fact.
+	void SetGeometry(const TArray<FString>& ForksInCyclicOrder, const std::string& Geometry);
+
+	/// Canonical key of the event set, and the vehicle atoms in canonical order.
+	FString Canonicalize(const TMap<FString, TArray<FMonitorEvent>>& ActorToEvents, TArray<FString>& OutVehicles) const;
+
+	bool Find(const FString& Key, const TArray<FString>& Vehicles, FDecisionSet& OutDecisions);
+	void Add(const FString& Key, const TArray<FString>& Vehicles, const FDecisionSet& Decisions);
+
+	int32 NumSymmetries() const { return Symmetries.Num() + 1; }
+
+private:
+	/// Fork, lane and exit atom renamings other than the identity
+	TArray<TMap<FString, FString>> Symmetries;
+
+	int32 Capacity = 1;
+	TLruCache<FString, FDecisionSet> Entries;
+};
@@ -0,0 +1,64 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Developer
+#include "TrafficDecisions.h"
+
+// STL
+#include <atomic>
+
+/// The decision about one vehicle. Trivially copyable, like the whole snapshot.
+struct FVehicleDecision
+{
+	FName Vehicle; // Actor name, without the "v_" prefix
+	bool bHasRightOfWay;
+	FName YieldsTo; // The first vehicle it must yield to, NAME_None if it has the right of way
+	FName Rule;
+};
+
+/// The decisions of a monitor's latest solve.
+struct TRAFFICMONITOR_API FDecisionSnapshot
+{
+	static constexpr int32 MaxVehicles = 64;
+
+	uint64 Version = 0; // 0 until the first solve, then incremented by each
+	int32 TimeStep = 0;
+	int32 NumVehicles = 0;
+	int32 NumDroppedVehicles = 0; // Decided vehicles past MaxVehicles, which the snapshot lacks
+	FVehicleDecision Vehicles[MaxVehicles];
+
+	const FVehicleDecision* Find(FName Vehicle) const;
+
+	/// False if the solve decided about more than MaxVehicles vehicles, so that Find misses some of them.
+	bool IsComplete() const { return NumDroppedVehicles == 0; }
+};
+
+/// Publishes decision snapshots from the game thread to readers on any thread.
+///
+/// Two buffers, each guarded by a sequence number that is odd while it is written. The writer fills the
+/// buffer readers are not pointed at, then points them at it; readers copy the latest buffer and retry
+/// only if the writer lapped them meanwhile. Neither side ever waits for the other.
+class TRAFFICMONITOR_API FDecisionSnapshotBuffer
+{
+public:
+	/// Single writer
+	void Publish(const FDecisionSet& Decisions, int32 TimeStep);
+
+	/// Any thread
+	FDecisionSnapshot Read() const;
+	uint64 GetVersion() const { return LatestVersion.load(std::memory_order_acquire); }
+
+private:
+	struct FBuffer
+	{
+		std::atomic<uint32> Sequence{ 0 };
+		FDecisionSnapshot Snapshot;
+	};
+
+	FBuffer Buffers[2];
+	std::atomic<uint32> Latest{ 0 };
+	std::atomic<uint64> LatestVersion{ 0 };
+};
@@ -31,6 +31,26 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Eval")
 	float Eval(float InTime);
 
+	/// Records a sample of a trajectory, keeping linear keys only where interpolating between the kept keys
+	/// would be off by more than Tolerance at some sample (swing door compression). Samples must come in time order.
+	/// The latest sample is held back until the next one, or FinishSamples.
+	UFUNCTION(BlueprintCallable, Category = "AddKey")
+	void AddSample(float InTime, float InDistance, float Tolerance);
+
+	UFUNCTION(BlueprintCallable, Category = "AddKey")
+	void FinishSamples();
+
+	const FRichCurve& GetCurve() const { return RichCurve; }
+
 private:
+	void AddLinearKey(float InTime, float InDistance);
+
 	FRichCurve RichCurve;
+
+	// Swing door state: the slopes from the last key that keep every later sample within the tolerance
+	bool bHasPendingSample = false;
+	float PendingTime = 0.f;
+	float PendingDistance = 0.f;
+	float MinSlope = 0.f;
+	float MaxSlope = 0.f;
 };
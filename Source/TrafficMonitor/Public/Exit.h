@@ -26,6 +26,10 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+#if WITH_EDITOR
+	virtual void PostEditMove(bool bFinished) override;
+#endif // WITH_EDITOR
+
 public:
 	UPROPERTY(EditAnywhere)
 	UBoxComponent* TriggerVolume;
@@ -48,7 +48,6 @@ public:
 	AFork(const FObjectInitializer &ObjectInitializer);
 
 //	virtual void OnConstruction(const FTransform &Transform) override;
-//	virtual void PostEditMove(bool bFinished) override;
 
 protected:
 	// Called when the game starts or when spawned
@@ -56,12 +55,20 @@ protected:
 
 #if WITH_EDITOR
 	virtual void PostEditChangeProperty(FPropertyChangedEvent &PropertyChangedEvent) override;
+	virtual void PostEditMove(bool bFinished) override;
 #endif // WITH_EDITOR
 
 public:
 	bool IsToTheRightOf(const AFork* OtherFork) const;
+	static bool IsToTheRightOf(const FVector& Direction, const FVector& OtherDirection);
 	void AddExit(AExit* Exit);
 
+#if WITH_EDITOR
+	/// Spawns the lanes of newly checked exits, unbuilt, and destroys those of unchecked ones.
+	/// Returns the spawned lanes, for ALane::BuildLanes.
+	TArray<ALane*> UpdateLanes();
+#endif // WITH_EDITOR
+
 public:	
 	UPROPERTY(EditAnywhere)
 	UBoxComponent* EntranceTriggerVolume;
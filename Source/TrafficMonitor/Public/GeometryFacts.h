@@ -0,0 +1,40 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// STL
+#include <string>
+
+/// The geometry facts of an intersection, indexed by the fork and lane atoms they are about,
+/// so that a moved fork or lane only has its own facts and those of its pairs recomputed.
+class TRAFFICMONITOR_API FGeometryFacts
+{
+public:
+	void Reset();
+
+	/// Replaces the facts about Atom alone, e.g. a lane's "laneFromTo" and "laneCorrectSignal".
+	void SetFacts(const FString& Atom, const TArray<FString>& Facts);
+
+	/// Replaces the facts relating two atoms, given in either order, e.g. both "overlaps" of two lanes.
+	void SetPairFacts(const FString& AtomA, const FString& AtomB, const TArray<FString>& Facts);
+
+	/// Drops every fact about Atom, paired or not.
+	void Remove(const FString& Atom);
+
+	int32 Num() const;
+
+	/// All facts, one per line, in an order that does not depend on the order of the updates.
+	const std::string& GetProgram() const;
+
+private:
+	static TPair<FString, FString> MakePairKey(const FString& AtomA, const FString& AtomB);
+
+	TMap<FString, TArray<FString>> FactsByAtom;
+	TMap<TPair<FString, FString>, TArray<FString>> FactsByPair; // Keyed by the ordered atoms
+	TMap<FString, TSet<FString>> PairedAtoms; // Both ways, to find the pairs of a removed atom
+
+	mutable std::string Program;
+	mutable bool bProgramIsStale = true;
+};
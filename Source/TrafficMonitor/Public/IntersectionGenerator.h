@@ -0,0 +1,37 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+
+// Developer
+#include "IntersectionLayout.h"
+
+// Generated
+#include "IntersectionGenerator.generated.h"
+
+/// Lays out an N-way intersection of forks, exits and lanes around itself, with a monitor covering it.
+UCLASS()
+class TRAFFICMONITOR_API AIntersectionGenerator : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AIntersectionGenerator(const FObjectInitializer &ObjectInitializer);
+
+#if WITH_EDITOR
+	UFUNCTION(CallInEditor)
+	void Generate();
+#endif // WITH_EDITOR
+
+public:
+	UPROPERTY(EditAnywhere)
+	FIntersectionLayoutSettings Settings;
+
+	UPROPERTY(EditAnywhere)
+	int32 Seed = 0; // For the angle jitter
+
+	UPROPERTY(VisibleAnywhere)
+	AIntersectionMonitor* GeneratedMonitor = nullptr;
+};
@@ -0,0 +1,94 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Developer
+#include "GeometryFacts.h"
+#include "LaneConflicts.h"
+#include "Lane.h"
+
+// Generated
+#include "IntersectionLayout.generated.h"
+
+class AIntersectionMonitor;
+
+USTRUCT(BlueprintType)
+struct FIntersectionLayoutSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere)
+	int32 NumApproaches = 4; // Evenly spaced
+
+	UPROPERTY(EditAnywhere)
+	TArray<float> ApproachAngles; // Degrees, replace the evenly spaced approaches when not empty
+
+	UPROPERTY(EditAnywhere)
+	float AngleJitter = 0.f; // Degrees, at most a quarter of the spacing, added at random to each approach
+
+	UPROPERTY(EditAnywhere)
+	int32 LanesPerApproach = 1; // Each way
+
+	UPROPERTY(EditAnywhere)
+	float LaneWidth = 300.f; // cm
+
+	UPROPERTY(EditAnywhere)
+	float MinRadius = 1000.f; // cm from the center to the forks and exits, grown until the approaches are apart
+
+	UPROPERTY(EditAnywhere)
+	bool bAllExitLanes = true; // Otherwise each lane of a fork only leads to the exit lanes with its index
+
+	UPROPERTY(EditAnywhere)
+	bool bUTurns = false;
+
+	UPROPERTY(EditAnywhere)
+	float MaxMeshLength = 1.f; // in meters, as ALane
+};
+
+/// A fork or an exit of a generated layout
+struct FLayoutEndpoint
+{
+	FString Name;
+	FVector Location;
+	FVector Direction; // Into the intersection for forks, out of it for exits
+	int32 Approach;
+	int32 LaneIndex; // From the center line outwards
+};
+
+struct FLayoutLane
+{
+	FString Name;
+	int32 Fork;
+	int32 Exit;
+};
+
+/// An N-way intersection laid out from FIntersectionLayoutSettings, either headless, to measure the geometry
+/// pipeline without a world, or spawned as AFork, AExit and ALane actors under a new AIntersectionMonitor.
+class TRAFFICMONITOR_API FIntersectionLayout
+{
+public:
+	static FIntersectionLayout Generate(const FIntersectionLayoutSettings& Settings, FRandomStream& Random);
+
+	/// The lane endpoints ALane::ComputeGeometry takes, in world space
+	TArray<FLaneEndpoints> GetLaneEndpoints() const;
+
+	/// The facts an AIntersectionMonitor would extract from the spawned actors at startup. Lanes overlap
+	/// when their mesh segments, as flat quads, come closer than their widths, rather than by physics overlaps.
+	void ExtractGeometryFacts(const TArray<FLaneGeometry>& LaneGeometries, FGeometryFacts& OutFacts, FLaneConflictMatrix& OutConflicts) const;
+
+	/// Spawns the forks, exits and built lanes around Transform, and a monitor that covers them.
+	AIntersectionMonitor* Spawn(UWorld* World, const FTransform& Transform) const;
+
+public:
+	TArray<FLayoutEndpoint> Forks;
+	TArray<FLayoutEndpoint> Exits;
+	TArray<FLayoutLane> Lanes;
+	float Radius = 0.f;
+	float LaneWidth = 0.f;
+	float MaxMeshLength = 1.f;
+
+private:
+	static bool SegmentsOverlap(const FLaneGeometry& A, const FLaneGeometry& B);
+};
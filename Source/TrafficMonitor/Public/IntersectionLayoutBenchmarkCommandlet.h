@@ -0,0 +1,24 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+// Generated
+#include "IntersectionLayoutBenchmarkCommandlet.generated.h"
+
+/// Measures how the lane fitting and the geometry fact extraction grow with generated intersections:
+///   UE4Editor-Cmd <Project> -run=IntersectionLayoutBenchmark [-MinApproaches=3] [-MaxApproaches=8]
+///     [-MaxLanesPerApproach=3] [-Repeats=5] [-Seed=0] [-AngleJitter=10] [-MatchingLanes] [-UTurns]
+/// Headless: no actor is spawned. Results are logged and written to Saved/IntersectionLayoutBenchmark.csv.
+UCLASS()
+class TRAFFICMONITOR_API UIntersectionLayoutBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UIntersectionLayoutBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
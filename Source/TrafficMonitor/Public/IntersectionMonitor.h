@@ -4,15 +4,121 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Actor.h"
+#include "Async/Future.h"
 #include "Runtime/Engine/Classes/Components/StaticMeshComponent.h"
 #include "Runtime/Engine/Classes/Components/BillboardComponent.h"
 #include "Runtime/Engine/Classes/Components/BoxComponent.h"
 
+// Developer
+#include "AnalyticsLog.h"
+#include "DecisionCache.h"
+#include "DecisionSnapshot.h"
+#include "GeometryFacts.h"
+#include "LaneConflicts.h"
+#include "MonitorEvent.h"
+#include "ShadowEvaluator.h"
+#include "TrafficDecisions.h"
+#include "TrafficRules.h"
+#include "VehicleStates.h"
+
 // STL
 #include <iostream>
 
 #include "IntersectionMonitor.generated.h"
 
+class AExit;
+class AFork;
+class ALane;
+class UDistanceTimeCurve;
+class UVehicleRegistry;
+
+/// Counters kept by each monitor over its lifetime, logged at EndPlay.
+struct FSolveStatistics
+{
+	int64 NumSolves = 0;
+	int64 NumSkippedSolves = 0; // Events that could not change any decision
+	int64 NumConflictFreeSolves = 0; // Decided from the lane bitsets without solving
+	int64 SumTimeSteps = 0; // Distinct time steps in the solved event sets
+	int64 SumGroundAtoms = 0;
+	int64 NumMeasuredSolves = 0;
+	int64 SumMeasuredGroundAtoms = 0;
+	int64 SumRawGroundAtoms = 0; // Same event sets without time normalization
+	int64 NumCacheLookups = 0;
+	int64 NumCacheHits = 0;
+	int64 NumServiceSolves = 0;
+	int64 NumServiceFallbacks = 0; // Solved in-process because the solver service was unavailable
+	int64 NumPartitionedSolves = 0; // Split into independent conflict components
+	int64 SumComponents = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FSolveStatistics& Statistics)
+	{
+		return Ar << Statistics.NumSolves << Statistics.NumSkippedSolves << Statistics.SumTimeSteps
+			<< Statistics.SumGroundAtoms << Statistics.NumMeasuredSolves << Statistics.SumMeasuredGroundAtoms
+			<< Statistics.SumRawGroundAtoms << Statistics.NumCacheLookups << Statistics.NumCacheHits
+			<< Statistics.NumServiceSolves << Statistics.NumServiceFallbacks << Statistics.NumConflictFreeSolves
+			<< Statistics.NumPartitionedSolves << Statistics.SumComponents;
+	}
+};
+
+/// A fork or lane as its geometry facts see it, taken from the actors on the game thread
+struct FMonitoredFork
+{
+	FString Atom; // "f_Fork"
+	FVector Direction;
+};
+
+struct FMonitoredLane
+{
+	FString Atom; // "l_Lane"
+	FString ForkAtom;
+	FString ExitAtom;
+	FString Signal;
+	TSet<FString> OverlappingLanes; // Atoms
+};
+
+/// What a monitor's startup task needs, so that it never touches an actor
+struct FMonitorStartupInput
+{
+	TArray<FMonitoredFork> Forks;
+	TArray<FMonitoredLane> Lanes; // In lane index order
+	FString LogFileFullName;
+	FString GeometryFileFullName;
+	FString AnalyticsFileFullName; // Empty without bExportAnalytics
+	FString TrafficRulesFileFullName;
+	FString ShadowTrafficRulesFileFullName; // Empty without shadow rules
+};
+
+/// What a monitor's startup task prepares on the thread pool
+struct FMonitorStartup
+{
+	FGeometryFacts GeometryFacts;
+	FLaneConflictMatrix LaneConflicts;
+	TMap<FString, TBitArray<>> LanesByForkAndSignal;
+	TSet<TPair<FString, FString>> AdjacentForks;
+	std::string Geometry;
+	TArray<FString> ForksInCyclicOrder;
+	TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> TrafficRules;
+	TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> ShadowTrafficRules;
+};
+
+/// A vehicle's distance along the lane it takes, recorded while it is in the monitor's extent box
+USTRUCT()
+struct FVehicleTrajectory
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TWeakObjectPtr<AActor> Vehicle;
+
+	UPROPERTY()
+	ALane* Lane = nullptr;
+
+	FString LaneName; // "l_Lane", kept for lanes removed before the vehicle leaves
+
+	UPROPERTY()
+	UDistanceTimeCurve* Curve = nullptr;
+};
+
 UCLASS()
 class TRAFFICMONITOR_API AIntersectionMonitor : public AActor
 {
@@ -23,13 +129,79 @@ public:
 	AIntersectionMonitor(const FObjectInitializer &ObjectInitializer);
 	virtual void OnConstruction(const FTransform &Transform) override;
 
+#if WITH_EDITOR
+	/// Spawns the lanes of every checked exit of the forks in the monitor, and rebuilds all of them at once.
+	UFUNCTION(CallInEditor)
+	void GenerateAllLanes();
+#endif // WITH_EDITOR
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:
-	void AddEvent(FString Actor, FString Atom);
-	std::string GetEventsString();
+	virtual void Tick(float DeltaTime) override;
+
+	void AddEvent(FString Actor, FMonitorEvent Event);
+	std::string GetEventsString() const;
+
+	/// The event facts of some vehicles' events, with their time steps replaced by dense ranks if normalized.
+	static std::string GetEventsString(const TMap<FString, TArray<FMonitorEvent>>& ActorToEvents, bool bNormalize, int32& OutNumTimeSteps);
+
+	UFUNCTION(BlueprintCallable)
+	float GetDecisionCacheHitRate() const;
+
+	/// The latest applied decisions. Safe to call from any thread while the monitor is alive, never blocks.
+	FDecisionSnapshot GetDecisionSnapshot() const { return DecisionSnapshot.Read(); }
+	uint64 GetDecisionVersion() const { return DecisionSnapshot.GetVersion(); }
+
+	/// Captures the events, tracked vehicles, last decisions and counters, to restart a scenario from later.
+	void SaveCheckpoint(TArray<uint8>& OutData) const;
+
+	/// Replaces the runtime state with a checkpoint of a monitor with the same geometry, and re-applies its decisions.
+	/// Tracked vehicles are found again by name; time steps are shifted to continue from the current time.
+	bool RestoreCheckpoint(const TArray<uint8>& Data);
+
+	/// The same, to and from a file relative to the project's Saved directory.
+	UFUNCTION(BlueprintCallable)
+	bool SaveCheckpointToFile(const FString& FileName) const;
+
+	UFUNCTION(BlueprintCallable)
+	bool RestoreCheckpointFromFile(const FString& FileName);
+
+	/// False if the latest decisions do not mention the vehicle.
+	UFUNCTION(BlueprintCallable)
+	bool GetVehicleDecision(FName Vehicle, bool& bOutHasRightOfWay, FName& OutYieldsTo, FName& OutRule) const;
+
+	/// Recompute the geometry facts of one moved, added, re-enabled or removed fork, exit or lane,
+	/// and of its pairs only. Lanes are not rebuilt: update them after rebuilding them.
+	UFUNCTION(BlueprintCallable)
+	void UpdateFork(AFork* Fork);
+
+	UFUNCTION(BlueprintCallable)
+	void UpdateExit(AExit* Exit);
+
+	UFUNCTION(BlueprintCallable)
+	void UpdateLane(ALane* Lane);
+
+	/// Updates the geometry of the playing monitors, e.g. after the actor was moved in the editor.
+	static void NotifyGeometryChanged(AActor* Actor);
+
+	/// False until the startup task has prepared the geometry facts and the rules. Events and geometry
+	/// changes until then are replayed in order, with the time steps they happened at.
+	bool IsReady() const { return bReady; }
+
+	/// Switches to another rule program between solves. The events are kept and decided again with the new rules.
+	void SetTrafficRules(const FString& RulesFile, TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> NewRules);
+
+	const std::string& GetGeometryProgram() const { return Geometry; }
+
+	/// Called by the UMonitorScheduler when this monitor's turn has come.
+	void RunScheduledSolve();
+
+	/// 2 if a vehicle is waiting at a fork, 1 if vehicles are inside, 0 otherwise.
+	int32 GetSolvePriority() const;
 
 	UFUNCTION()
 	void OnArrival(
@@ -56,6 +228,14 @@ public:
 			UPrimitiveComponent* OtherComp,
 			int32 OtherBodyIndex);
 
+	/// Ends one of a vehicle's component overlaps with a fork trigger
+	UFUNCTION()
+	void OnLeaveTrigger(
+			UPrimitiveComponent* OverlappedComp,
+			AActor* OtherActor,
+			UPrimitiveComponent* OtherComp,
+			int32 OtherBodyIndex);
+
 	UFUNCTION()
 	void OnEnterLane(AActor* ThisActor, AActor* OtherActor);
 
@@ -71,26 +251,187 @@ public:
 
 	float TimeResolution = 0.5f; // Events occuring in the same 0.5 seconds interval are simultaneous
 
+	// The rules only compare time steps for order and equality,
+	// so the solver is given their dense ranks instead of the raw, ever growing, values.
+	UPROPERTY(EditAnywhere)
+	bool bNormalizeTimeSteps = true;
+
+	// Also ground every event set with raw time steps to log the grounding size reduction.
+	UPROPERTY(EditAnywhere)
+	bool bMeasureTimeNormalization = false;
+
+	// Give every vehicle the right of way without solving while at most one vehicle waits at a fork,
+	// and none of the lanes it wants overlaps an occupied lane. Only sound for rules where vehicles only yield
+	// to other waiting vehicles, or to vehicles on overlapping lanes, like all-way-stop_new.cl, so it is off
+	// by default: it runs before the cache and the solver and would override any other rules.
+	UPROPERTY(EditAnywhere)
+	bool bSkipConflictFreeSolves = false;
+
+	// Split the vehicles into groups that cannot affect each other's decisions, through overlapping lanes,
+	// adjacent forks or, for rules that yield by arrival order alone, waiting at the same time,
+	// and solve the groups separately on all cores. In-process solves only.
+	UPROPERTY(EditAnywhere)
+	bool bPartitionConflictComponents = true;
+
+	// Reuse the decisions of earlier solves of the same situation, up to relative times,
+	// vehicle names and symmetric rotations of the intersection. Requires bNormalizeTimeSteps.
+	UPROPERTY(EditAnywhere)
+	bool bUseDecisionCache = true;
+
+	UPROPERTY(EditAnywhere)
+	int32 DecisionCacheCapacity = 1024;
+
+	// Publish event batches to the out-of-process solver service (SolverService/) when it is running,
+	// and apply its decisions on a later frame. Falls back to solving in-process otherwise.
+	UPROPERTY(EditAnywhere)
+	bool bUseSolverService = false;
+
+	UPROPERTY(EditAnywhere)
+	FString TrafficRulesFile = "all-way-stop_new.cl"; // Relative to the plugin's LogicSolver directory
+
+	// Solve with the vehicle states tracked by the monitor (waiting at a fork, wanted, reserved and left lanes)
+	// instead of the raw events. Needs rules over these states, like all-way-stop_hybrid.cl, for the shadow rules too.
+	UPROPERTY(EditAnywhere)
+	bool bHybridState = false;
+
+	// Candidate rules, e.g. an edited copy of TrafficRulesFile, solved for the same event sets on a background thread.
+	// They must derive the same decision predicates (mustYieldToForRule/3, hasRightOfWay/1) from the same facts.
+	// Divergences from the applied decisions go to Saved/<Monitor>ShadowDivergences.log. Empty to disable.
+	UPROPERTY(EditAnywhere)
+	FString ShadowTrafficRulesFile;
+
+	// Stream the events, applied decisions and solve timings to Saved/Analytics/<Monitor>_<start time>.tmal,
+	// a compressed columnar file for offline analysis (see FAnalyticsLog).
+	UPROPERTY(EditAnywhere)
+	bool bExportAnalytics = false;
+
+	// Also export the distance of each vehicle along the lane it takes over time, keeping only the samples
+	// needed to interpolate the others within TrajectoryTolerance (cm). Needs bExportAnalytics.
+	UPROPERTY(EditAnywhere)
+	bool bRecordTrajectories = false;
+
+	UPROPERTY(EditAnywhere)
+	float TrajectoryTolerance = 10.f;
+
 private:
-	void CreateLogFile();
 	void SetupTriggers();
-	void LoadGeometryFacts();
+	FMonitorStartupInput GetStartupInput();
+	static FMonitorStartup RunStartup(const FMonitorStartupInput& Input, FAnalyticsLog* AnalyticsLog); // Any thread
+	void FinishStartup(const FMonitorStartup& Result);
+	bool DeferUntilReady(TFunction<void()>&& Replay); // True if deferred
+	bool DeferGeometryChange(AActor* Actor);
+	void BindFork(AFork* Fork, bool bBind);
+	void BindLane(ALane* Lane, bool bBind);
+	void UpdateGeometryOf(AActor* Actor);
+	void UpdateForkFacts(AFork* Fork);
+	void UpdateLaneFacts(ALane* Lane);
+	static FMonitoredFork GetMonitoredFork(const AFork* Fork);
+	static FMonitoredLane GetMonitoredLane(ALane* Lane);
+	static void SetForkFacts(const FMonitoredFork& Fork, const TArray<FMonitoredFork>& Forks, FGeometryFacts& Facts, TSet<TPair<FString, FString>>& OutAdjacentForks);
+	static void SetLaneFacts(const FMonitoredLane& Lane, const TArray<FString>& LaneAtoms, FGeometryFacts& Facts, FLaneConflictMatrix& Conflicts, TMap<FString, TBitArray<>>& OutLanesByForkAndSignal);
+	void OnGeometryChanged();
+	TArray<FString> GetForksInCyclicOrder() const;
+	static TArray<FString> GetForksInCyclicOrder(TArray<FMonitoredFork> Forks);
+	FString GetGeometryFileFullName() const;
 	void WriteGeometryToFile();
-	void LoadTrafficRules();
+	static void WriteGeometryToFile(const FString& GeometryFileFullName, const std::string& Program);
 	void AppendToLogfile(std::string EventMessage);
+	void RequestSolve();
 	void Solve();
+	bool ComputeDecisions(const std::string& Program, int32 NumTimeSteps, FDecisionSet& OutDecisions);
+	bool SubmitToSolverService(const std::string& Program, int32 NumTimeSteps, const FString& CacheKey, const TArray<FString>& CanonicalVehicles);
+	void PollSolverService();
+	void CacheAndApplyDecisions(const FString& CacheKey, const TArray<FString>& CanonicalVehicles, const std::string& Program, const FDecisionSet& Decisions);
+	void ApplyDecisions(const FDecisionSet& Decisions);
+	int32 TrackVehicle(AActor* Vehicle); // Its registry id
+	void UntrackVehicle(int32 VehicleId);
+	bool IsTracking(int32 VehicleId) const;
+	bool EnterTrigger(const UPrimitiveComponent* Trigger, const AActor* Actor); // True for the first overlapping component only
+	static bool IsVehicle(const AActor* Actor);
+	void SolveIfNeeded(const FMonitorEvent& Event);
+	bool MayAffectDecisions(const FMonitorEvent& Event) const;
+	bool IsConflictFree() const;
+	FDecisionSet GetConflictFreeDecisions() const;
+	TBitArray<> GetWantedLanes() const; // Of all waiting vehicles
+	void SetOnLane(const FString& Vehicle, const FString& Lane, bool bOnLane);
+	void RebuildLaneOccupancy();
+	void RebuildVehicleStates();
+	void StartTrajectory(AActor* Vehicle, ALane* Lane);
+	void SampleTrajectories();
+	void FinishTrajectory(const FString& Vehicle, FVehicleTrajectory& Trajectory); // Writes it to the analytics file
+	std::string GetEventsString(bool bNormalize, int32& OutNumTimeSteps) const;
+	std::string GetSolverFacts(const TMap<FString, TArray<FMonitorEvent>>& ActorToEvents, bool bNormalize, int32& OutNumTimeSteps) const; // Events or vehicle states
+	TArray<TArray<FString>> GetConflictComponents() const; // Vehicles, by actor name
+	void SolveComponents(const TArray<TArray<FString>>& Components);
+	size_t CountGroundAtoms(const std::string& EventsString) const;
+	void LogStatistics() const;
+	int32 GetCurrentTimeStep() const;
+	void RecountTriggerOverlaps();
 
 	template <class ActorClass>
 	void GetIntersectingActors(TArray<ActorClass*>& OutArray);
 	
 	FString LogFileName;
 	FString LogFileFullName;
-	size_t NumberOfForks;
 
-	TMap<FString, FString> ActorToEventsMap;
+	struct FDeferredEvent
+	{
+		int32 TimeStep;
+		TFunction<void()> Replay;
+	};
+	bool bReady = false;
+	TFuture<FMonitorStartup> Startup;
+	TArray<FDeferredEvent> DeferredEvents; // Overlap callbacks before the monitor was ready
+	TArray<TWeakObjectPtr<AActor>> DeferredGeometryChanges;
+	int32 ReplayTimeStep = INDEX_NONE; // Of the deferred event being replayed
 
-	std::string Geometry;
-	std::string TrafficRules;
+	TMap<FString, TArray<FMonitorEvent>> ActorToEventsMap;
+
+	FGeometryFacts GeometryFacts;
+	FLaneConflictMatrix LaneConflicts;
+	TMap<FString, TBitArray<>> LanesByForkAndSignal; // "f_Fork/signal" to its lanes
+	TMap<FString, TBitArray<>> WaitingVehicleLanes; // Vehicles that arrived but did not enter, to their wanted lanes
+	TMap<FString, TBitArray<>> VehicleLanes; // Lanes each vehicle entered and did not leave
+	TArray<int32> LaneOccupancy; // Vehicles per lane
+	TBitArray<> OccupiedLanes;
+	TSet<TPair<FString, FString>> AdjacentForks; // Both orders of the forks of every isToTheRightOf fact
+	FVehicleStates VehicleStates;
+
+	TMap<TPair<const UPrimitiveComponent*, const AActor*>, int32> TriggerOverlapCounts; // Overlapping components per fork trigger and vehicle
+
+	UPROPERTY()
+	TArray<UPrimitiveComponent*> ForkTriggers;
+
+	UPROPERTY()
+	TArray<AFork*> GeometryForks;
+
+	UPROPERTY()
+	TArray<ALane*> GeometryLanes;
+
+	std::string Geometry; // The program of GeometryFacts
+	TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> TrafficRules; // Shared with every monitor using the same file
+
+	// Shared by the monitors of the world. The vehicles are keyed by name here, as in the events.
+	UPROPERTY()
+	UVehicleRegistry* VehicleRegistry = nullptr;
+
+	TBitArray<> TrackedVehicles; // By registry id
+
+	UPROPERTY()
+	TMap<FString, FVehicleTrajectory> Trajectories; // By actor name, the monitor ticks while there are any
+
+	FSolveStatistics Statistics;
+	FDecisionCache DecisionCache;
+	FDecisionSnapshotBuffer DecisionSnapshot;
+	FDecisionSet LastDecisions;
+	FAnalyticsLog Analytics;
+	TUniquePtr<FShadowEvaluator> ShadowEvaluator;
 
-	TMap<FString, class ACarlaWheeledVehicle*> VehiclePointers;
+	// Outstanding solver service requests, oldest first. Only the newest one's decisions are applied.
+	TArray<uint64> ServiceTickets;
+	FString ServiceCacheKey;
+	TArray<FString> ServiceCanonicalVehicles;
+	std::string ServiceProgram;
+	int32 ServiceNumTimeSteps = 0;
+	double ServiceSubmitTime = 0.0;
 };
@@ -14,6 +14,38 @@
 // Generated
 #include "Lane.generated.h"
 
+/// Everything a lane's shape depends on, copied off its fork and exit.
+struct FLaneEndpoints
+{
+	FTransform LaneTransform;
+	FVector EntranceLocation;
+	FVector EntranceDirection;
+	float EntranceWidth;
+	FVector ExitLocation;
+	FVector ExitDirection;
+	float ExitWidth;
+	float MaxMeshLength;
+};
+
+/// One spline mesh, in the lane's local space
+struct FLaneSegment
+{
+	FVector StartPosition;
+	FVector EndPosition;
+	FVector StartDirection;
+	FVector EndDirection;
+	FVector2D StartScale;
+	FVector2D EndScale;
+};
+
+/// The fitted spline and its mesh segments.
+/// Computed without touching any UObject, so that many lanes can be built in parallel.
+struct FLaneGeometry
+{
+	FSplineCurves SplineCurves;
+	TArray<FLaneSegment> Segments;
+};
+
 UCLASS()
 class TRAFFICMONITOR_API ALane : public AActor
 {
@@ -26,12 +58,24 @@ public:
 protected:
 	virtual void OnConstruction(const FTransform &Transform) override;
 
+#if WITH_EDITOR
+	virtual void PostEditMove(bool bFinished) override;
+#endif // WITH_EDITOR
+
 public:	
 	void Init(class AFork* MyFork, AExit* MyExit);
-	void SetupSpline();
-	void SetupSplineMeshes();
 	FString GetCorrectSignal();
 
+	/// The signal of a lane entered and left in these directions: "left", "right" or "off".
+	static FString GetCorrectSignal(const FVector& EntranceDirection, const FVector& ExitDirection);
+
+	FLaneEndpoints GetEndpoints() const;
+	static FLaneGeometry ComputeGeometry(const FLaneEndpoints& Endpoints);
+	void ApplyGeometry(const FLaneGeometry& Geometry);
+
+	/// Fits and samples all the lanes in parallel, then creates their components on the calling (game) thread.
+	static void BuildLanes(const TArray<ALane*>& Lanes);
+
 public:
 	UPROPERTY(VisibleAnywhere)
 	class AFork* MyFork = nullptr;
@@ -58,7 +102,7 @@ public:
 	float MaxMeshLength = 1.0f; // in meters
 
 private:
-	bool MinimumCurvatureVariation(
+	static bool MinimumCurvatureVariation(
 		FVector2D p0, 
 		FVector2D p1, 
 		FVector2D d0, 
@@ -0,0 +1,43 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/// The "overlaps/2" facts of an intersection as a bit matrix over dense lane indices.
+/// Sets of lanes are bit arrays of the same width, so that conflicts are a few word-wide ANDs.
+class TRAFFICMONITOR_API FLaneConflictMatrix
+{
+public:
+	void Reset();
+
+	/// The index of a lane atom, e.g. "l_Lane_2", added if new. Lanes conflict with themselves.
+	int32 AddLane(const FString& Lane);
+
+	/// Symmetric. Lanes always conflict with themselves.
+	void SetConflict(int32 LaneA, int32 LaneB, bool bConflict);
+
+	int32 FindLane(const FString& Lane) const;
+	const FString& GetLane(int32 Lane) const { return LaneNames[Lane]; }
+	int32 Num() const { return Conflicts.Num(); }
+
+	/// An empty set of lanes
+	TBitArray<> MakeLaneSet() const { return TBitArray<>(false, Num()); }
+
+	/// The lanes overlapping Lane, itself included
+	const TBitArray<>& GetConflicts(int32 Lane) const { return Conflicts[Lane]; }
+
+	/// Whether any lane of Lanes overlaps any lane of Others
+	bool AnyConflict(const TBitArray<>& Lanes, const TBitArray<>& Others) const;
+
+	/// Sets or clears a lane of a set, growing the set if the lane was added after it
+	static void SetLane(TBitArray<>& Lanes, int32 Lane, bool bValue);
+
+	static bool Intersects(const TBitArray<>& A, const TBitArray<>& B);
+	static void UnionWith(TBitArray<>& Into, const TBitArray<>& From);
+
+private:
+	TMap<FString, int32> LaneIndices;
+	TArray<FString> LaneNames;
+	TArray<TBitArray<>> Conflicts; // One row per lane
+};
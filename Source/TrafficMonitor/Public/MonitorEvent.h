@@ -0,0 +1,30 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/// An event atom whose last argument is a time step, e.g. "arrivesAtForkAtTime(v_1, f_2, 7)."
+/// The first argument is always the vehicle the event is about.
+struct FMonitorEvent
+{
+	FString Predicate;
+	TArray<FString> Arguments; // All arguments but the time step
+	int32 TimeStep;
+
+	FMonitorEvent()
+		: TimeStep(0)
+	{}
+
+	FMonitorEvent(const FString& InPredicate, TArray<FString> InArguments, int32 InTimeStep)
+		: Predicate(InPredicate), Arguments(MoveTemp(InArguments)), TimeStep(InTimeStep)
+	{}
+
+	friend FArchive& operator<<(FArchive& Ar, FMonitorEvent& Event)
+	{
+		return Ar << Event.Predicate << Event.Arguments << Event.TimeStep;
+	}
+
+	FString ToAtom(int32 Time) const;
+	FString ToAtom() const { return ToAtom(TimeStep); }
+};
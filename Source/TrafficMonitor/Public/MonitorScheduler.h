@@ -0,0 +1,63 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Async/Future.h"
+
+// Developer
+#include "TrafficRules.h"
+
+// Generated
+#include "MonitorScheduler.generated.h"
+
+class AIntersectionMonitor;
+
+/// Owns the pending solve requests of all monitors in a world.
+///
+/// Requests made during a frame are coalesced per monitor and served on the next tick,
+/// highest priority first, until the per-frame budget (TrafficMonitor.SolveBudgetMs) is spent.
+/// The rest are deferred to later frames, gaining priority the longer they wait.
+///
+/// Also swaps the monitors' rule programs (TrafficMonitor.ReloadRules): new programs are read, parsed and
+/// validated on the thread pool, and every affected monitor switches at the start of the same tick.
+UCLASS()
+class TRAFFICMONITOR_API UMonitorScheduler : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	void RequestSolve(AIntersectionMonitor* Monitor);
+	void CancelSolve(AIntersectionMonitor* Monitor);
+
+	/// Reloads the rule files of all monitors, or switches all of them to RulesFile if not empty.
+	/// Rule files are relative to the plugin's LogicSolver directory.
+	void ReloadRules(const FString& RulesFile);
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	struct FSolveRequest
+	{
+		TWeakObjectPtr<AIntersectionMonitor> Monitor;
+		uint64 RequestFrame;
+	};
+
+	struct FRulesReload
+	{
+		FString RulesFile;
+		bool bSwitchAllMonitors;
+		TFuture<TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe>> Rules;
+	};
+
+	void SwitchReloadedRules();
+
+	TArray<FSolveRequest> PendingRequests;
+	TArray<FRulesReload> PendingReloads;
+	int64 NumDeferredSolves = 0;
+};
@@ -0,0 +1,71 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Developer
+#include "MonitorEvent.h"
+#include "TrafficRules.h"
+
+// STL
+#include <string>
+
+/// Intersection geometry read back from a "<Monitor>Geometry.cl" file.
+struct TRAFFICMONITOR_API FFuzzGeometry
+{
+	std::string Facts;
+	TArray<FString> Forks;
+	TMap<FString, TArray<FString>> LanesByFork;
+	TMap<FString, FString> LaneSignals;
+	TMap<FString, TSet<FString>> LaneOverlaps;
+
+	bool Load(const FString& FileFullName);
+	bool Parse(const FString& Text);
+};
+
+enum class EFuzzFailure : uint8
+{
+	None,
+	Unsatisfiable, // No answer set, or the solver failed
+	Deadlock, // Vehicles are waiting, none of them has the right of way and they only yield to each other
+	Conflict, // A vehicle both has the right of way and must yield, or two waiting vehicles with overlapping lanes may both go
+};
+
+/// The events a monitor would hold at some point in time.
+struct FFuzzScenario
+{
+	TArray<FMonitorEvent> Events; // Grouped by vehicle, in the order they happened
+};
+
+/// Generates random, physically plausible event sets for a geometry, looks for unsatisfiable,
+/// deadlocked and conflicting decisions, and shrinks the failing event sets.
+/// Safe to use from several threads at once.
+class TRAFFICMONITOR_API FRulesFuzzer
+{
+public:
+	FRulesFuzzer(TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> InRules, const FFuzzGeometry& InGeometry, int32 InMaxVehicles);
+
+	/// Vehicles queue at their forks, enter after they arrive and leave their lane after they enter it.
+	/// The scenario is observed at a random time, without the vehicles that have left the monitor by then.
+	FFuzzScenario Generate(FRandomStream& Random) const;
+
+	EFuzzFailure Check(const FFuzzScenario& Scenario) const;
+
+	/// One vehicle inside on a lane and one waiting for a lane that overlaps it, which is no deadlock
+	/// whatever the rules say. Empty if no two lanes of the geometry overlap.
+	FFuzzScenario MakeYieldToInsideScenario() const;
+
+	/// Drops whole vehicles, then the latest events of the remaining ones, as long as the failure remains.
+	FFuzzScenario Minimize(const FFuzzScenario& Scenario, EFuzzFailure Failure) const;
+
+	/// Event facts followed by the geometry facts
+	std::string ToProgram(const FFuzzScenario& Scenario) const;
+
+	static const TCHAR* ToString(EFuzzFailure Failure);
+
+private:
+	TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> Rules;
+	FFuzzGeometry Geometry;
+	int32 MaxVehicles;
+};
@@ -0,0 +1,64 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/Runnable.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "Containers/Queue.h"
+
+// Developer
+#include "TrafficDecisions.h"
+#include "TrafficRules.h"
+
+// STL
+#include <string>
+
+class FRunnableThread;
+class FEvent;
+
+/// Solves the event sets of a monitor with a second, candidate rule program on a low priority thread,
+/// and records where its decisions diverge from the ones the monitor applied.
+/// Its decisions are never applied.
+class TRAFFICMONITOR_API FShadowEvaluator : public FRunnable
+{
+public:
+	FShadowEvaluator(const FString& InMonitorName, TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> InShadowRules);
+	virtual ~FShadowEvaluator();
+
+	/// Game thread. Drops the event set if the worker is MaxPending sets behind.
+	void Submit(const std::string& Program, const FDecisionSet& ActiveDecisions);
+
+	void LogStatistics() const;
+
+	// FRunnable
+	virtual uint32 Run() override;
+	virtual void Stop() override;
+
+	static constexpr int32 MaxPending = 64;
+
+private:
+	struct FJob
+	{
+		std::string Program;
+		FDecisionSet ActiveDecisions;
+	};
+
+	void Evaluate(const FJob& Job);
+
+	FString MonitorName;
+	TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> ShadowRules;
+	FString DivergenceFileFullName;
+
+	TQueue<FJob, EQueueMode::Spsc> Jobs;
+	FThreadSafeCounter NumPending;
+	FEvent* WorkAvailable = nullptr;
+	FThreadSafeCounter bStopping;
+	FRunnableThread* Thread = nullptr;
+
+	FThreadSafeCounter NumSubmitted;
+	FThreadSafeCounter NumDropped;
+	FThreadSafeCounter NumEvaluated;
+	FThreadSafeCounter NumDivergent;
+	FThreadSafeCounter NumFailed; // The shadow rules had no answer
+};
@@ -0,0 +1,59 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/PlatformMemory.h"
+
+// Developer
+#include "TrafficDecisions.h"
+
+// STL
+#include <string>
+
+namespace TrafficSolverService
+{
+	struct FRegion;
+}
+
+/// Game thread side of the out-of-process solver service.
+/// Event batches are published into the shared memory ring and decisions are polled on later frames.
+class TRAFFICMONITOR_API FSolverServiceClient
+{
+public:
+	enum class EPollResult
+	{
+		Pending,
+		Done,
+		Failed, // Unsatisfiable, solver error or lost service
+	};
+
+	/// The process-wide client, connected lazily.
+	static FSolverServiceClient& Get();
+
+	~FSolverServiceClient();
+
+	/// Whether the service process is running and responsive; reconnects if needed.
+	bool IsServiceAlive();
+
+	/// Publishes a solve request. Returns false if the service is not running or the ring is full.
+	bool Submit(const FString& RulesFileFullName, const std::string& Program, uint64& OutTicket);
+
+	EPollResult Poll(uint64 Ticket, FDecisionSet& OutDecisions);
+
+	/// Frees the slot of a request whose result is no longer wanted.
+	void Discard(uint64 Ticket);
+
+private:
+	bool Connect();
+	void Disconnect();
+	void ReleaseDiscardedSlots();
+
+	FPlatformMemory::FSharedMemoryRegion* SharedMemory = nullptr;
+	TrafficSolverService::FRegion* Region = nullptr;
+
+	uint64 NextTicket = 1;
+	uint64 LastHeartbeat = 0;
+	double LastHeartbeatChange = 0.0;
+	TSet<uint64> DiscardedTickets;
+};
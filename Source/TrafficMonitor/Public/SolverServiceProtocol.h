@@ -0,0 +1,63 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+// Layout of the shared memory region between the monitors and the out-of-process solver service.
+// Plain C++ only: this header is also compiled into the service (SolverService/TrafficSolverService.cpp).
+
+#include <atomic>
+#include <cstdint>
+
+namespace TrafficSolverService
+{
+	// Created by the service; opened by the monitors.
+	// POSIX platforms prefix it with '/' when calling shm_open.
+	constexpr char RegionName[] = "TrafficMonitorSolverService";
+
+	constexpr uint32_t Magic = 0x4C4F5354; // "TSOL"
+	constexpr uint32_t Version = 1;
+
+	constexpr uint32_t NumSlots = 32;
+	constexpr uint32_t MaxRulesFileBytes = 512;
+	constexpr uint32_t MaxProgramBytes = 60 * 1024;
+	constexpr uint32_t MaxResponseBytes = 16 * 1024;
+
+	// A slot cycles Free -> Writing -> Ready -> Solving -> Done -> Free.
+	// The monitors own it while Free, Writing and Done; the service while Ready and Solving.
+	enum ESlotState : uint32_t
+	{
+		Free = 0,
+		Writing,
+		Ready,
+		Solving,
+		Done,
+	};
+
+	struct FSlot
+	{
+		std::atomic<uint32_t> State;
+		uint32_t ProgramBytes;
+		uint64_t Ticket; // Assigned by the monitors, slot index is Ticket % NumSlots
+		char RulesFile[MaxRulesFileBytes]; // Full path, NUL terminated
+		char Program[MaxProgramBytes]; // Events and geometry facts, not NUL terminated
+
+		// First line "ok", "unsat" or "error <message>", then one decision per line:
+		//   "y <Vehicle> <YieldsTo> <Rule>" for mustYieldToForRule/3
+		//   "r <Vehicle>" for hasRightOfWay/1
+		uint32_t ResponseBytes;
+		char Response[MaxResponseBytes];
+	};
+
+	struct FRegion
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		std::atomic<uint64_t> Heartbeat; // Incremented by the service every few milliseconds
+		FSlot Slots[NumSlots];
+	};
+
+	constexpr uint64_t RegionBytes = sizeof(FRegion);
+
+	// The service is considered gone if its heartbeat does not move for this long.
+	constexpr double HeartbeatTimeoutSeconds = 1.0;
+}
@@ -0,0 +1,56 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Developer
+#include "AnalyticsLog.h"
+#include "TrafficRules.h"
+
+// STL
+#include <string>
+
+/// Latency distribution of a solver configuration over the replayed event sets, in milliseconds.
+struct FSolverLatencies
+{
+	double Mean = 0.0;
+	double P50 = 0.0;
+	double P95 = 0.0;
+	double P99 = 0.0;
+	double Max = 0.0;
+	int32 NumFailures = 0; // Unsatisfiable, or the solver failed
+	int32 NumMismatches = 0; // Other decisions than with the default options
+
+	double Get(const FString& Metric) const;
+};
+
+/// Replays the event sets monitors solved, from their analytics traces, with several solver configurations.
+class TRAFFICMONITOR_API FSolverTuner
+{
+public:
+	/// Adds the event sets of a trace at each of its solves, or after each of its events if it recorded no solve,
+	/// with the geometry of its monitor. Vehicles count as present from their first to their last event.
+	/// With bHybridState the event sets are replayed as the vehicle state facts of hybrid rule programs.
+	/// Returns the number of event sets added.
+	int32 AddTrace(const FAnalyticsTables& Trace, const std::string& Geometry, bool bHybridState);
+
+	/// Whether the rules are written against the vehicle state facts rather than the events.
+	/// False with OutError set if they derive their decisions from neither.
+	static bool NeedsHybridState(const FTrafficRules& Rules, FString& OutError);
+
+	/// Keeps at most MaxPrograms of the event sets, evenly spread over the traces.
+	void Sample(int32 MaxPrograms);
+
+	int32 Num() const { return Programs.Num(); }
+
+	/// Every combination of the options, "default" standing for no option, and 1 for a single thread.
+	static TArray<FSolverConfig> MakeGrid(const TArray<FString>& Configurations, const TArray<FString>& Heuristics, const TArray<int32>& Threads);
+
+	/// Solves every event set NumRepeats times in a row on the calling thread, and keeps the fastest time of each.
+	/// The decisions are compared with InOutDecisions, or stored there if it is empty.
+	FSolverLatencies Measure(const FTrafficRules& Rules, const FSolverConfig& Config, int32 NumRepeats, TArray<TSet<FString>>& InOutDecisions) const;
+
+private:
+	TArray<std::string> Programs;
+};
@@ -0,0 +1,45 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/// A "mustYieldToForRule(Vehicle, YieldsTo, Rule)" atom.
+struct FYieldDecision
+{
+	FString Vehicle; // Vehicle atoms, e.g. "v_Vehicle_3"
+	FString YieldsTo;
+	FString Rule;
+
+	friend FArchive& operator<<(FArchive& Ar, FYieldDecision& Decision)
+	{
+		return Ar << Decision.Vehicle << Decision.YieldsTo << Decision.Rule;
+	}
+};
+
+/// The decision atoms of a solve.
+struct FDecisionSet
+{
+	TArray<FYieldDecision> MustYield;
+	TArray<FString> RightOfWay; // "hasRightOfWay(Vehicle)" atoms
+
+	/// One string per decision atom, comparable between two solves
+	TSet<FString> ToAtoms() const
+	{
+		TSet<FString> Atoms;
+		for (const FYieldDecision& Yield : MustYield)
+		{
+			Atoms.Add("mustYieldToForRule(" + Yield.Vehicle + ", " + Yield.YieldsTo + ", " + Yield.Rule + ")");
+		}
+		for (const FString& Vehicle : RightOfWay)
+		{
+			Atoms.Add("hasRightOfWay(" + Vehicle + ")");
+		}
+		return Atoms;
+	}
+
+	friend FArchive& operator<<(FArchive& Ar, FDecisionSet& Decisions)
+	{
+		return Ar << Decisions.MustYield << Decisions.RightOfWay;
+	}
+};
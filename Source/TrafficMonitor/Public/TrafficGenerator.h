@@ -0,0 +1,88 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+
+// Developer
+#include "IntersectionMonitor.h"
+
+// Generated
+#include "TrafficGenerator.generated.h"
+
+class AFork;
+class ALane;
+class AVehicleProxy;
+
+/// Spawns vehicle proxies onto random lanes of a monitored intersection at a steady rate,
+/// and logs the throughput and the latency of the monitor's decisions.
+UCLASS()
+class TRAFFICMONITOR_API ATrafficGenerator : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	ATrafficGenerator(const FObjectInitializer &ObjectInitializer);
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+public:
+	virtual void Tick(float DeltaTime) override;
+
+	/// Called by each proxy when it reaches the end of its route. Negative times never happened.
+	void RecordTrip(float SpawnTime, float ArrivalTime, float FirstDecisionTime, float ProceedTime, float FinishTime);
+
+	void LogReport() const;
+
+public:
+	UPROPERTY(EditAnywhere)
+	AIntersectionMonitor* Monitor = nullptr; // Drives on the lanes inside its extent
+
+	UPROPERTY(EditAnywhere)
+	float VehiclesPerMinute = 120.f;
+
+	UPROPERTY(EditAnywhere)
+	int32 MaxVehicles = 0; // Stop spawning after this many, 0 for no limit
+
+	UPROPERTY(EditAnywhere)
+	float MinSpeed = 6.f; // m/s
+
+	UPROPERTY(EditAnywhere)
+	float MaxSpeed = 12.f; // m/s
+
+	UPROPERTY(EditAnywhere)
+	float ApproachLength = 40.f; // Meters driven before the fork
+
+	UPROPERTY(EditAnywhere)
+	float DepartureLength = 30.f; // Meters driven after the exit
+
+	UPROPERTY(EditAnywhere)
+	float MaxWaitSeconds = 30.f; // Waiting proxies proceed anyway after this long, e.g. when the rules are unsatisfiable
+
+	UPROPERTY(EditAnywhere)
+	float ReportIntervalSeconds = 10.f;
+
+	int32 NumTimedOut = 0;
+
+private:
+	UPROPERTY()
+	TArray<ALane*> Lanes;
+
+	TMap<AFork*, TWeakObjectPtr<AVehicleProxy>> LastProxyOnFork;
+
+	float SpawnBudget = 0.f;
+	float StartTime = 0.f;
+	float LastReportTime = 0.f;
+
+	int32 NumSpawned = 0;
+	int32 NumDeferred = 0; // The previous proxy on the fork was still too close to the start
+	int32 NumFinished = 0;
+	int32 NumDecided = 0;
+	float SumDecisionLatency = 0.f; // From arrival to the first decision about the proxy
+	float MaxDecisionLatency = 0.f;
+	float SumWait = 0.f; // From arrival to the right of way
+	float SumTripTime = 0.f;
+};
@@ -0,0 +1,104 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Developer
+#include "TrafficDecisions.h"
+
+// STL
+#include <string>
+
+namespace Clingo
+{
+	class Control;
+}
+
+/// clingo options to solve a rule program with, e.g. "--configuration=trendy" or "--parallel-mode=2".
+/// Read from the "<rules file>.config" sidecar, one option per line and "%" comments, as written by the
+/// TrafficSolverTune commandlet. Rule files without a sidecar are solved with clingo's defaults.
+struct TRAFFICMONITOR_API FSolverConfig
+{
+	TArray<FString> Arguments;
+
+	static FString GetFileFullName(const FString& RulesFileFullName) { return RulesFileFullName + ".config"; }
+
+	bool Load(const FString& FileFullName);
+	bool Save(const FString& FileFullName, const FString& Comment) const;
+
+	/// The options separated by spaces, "default" if none
+	FString ToString() const;
+};
+
+/// An immutable, already parsed traffic rule program.
+/// Rule files are read and parsed once per process and shared by every monitor that selects them.
+class TRAFFICMONITOR_API FTrafficRules
+{
+public:
+	/// Returns the shared program for a rule file, reading and parsing it on first use.
+	/// Returns nullptr if the file cannot be read, does not parse or derives no decision predicate.
+	static TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> Get(const FString& RulesFileFullName);
+
+	/// Reads and parses the rule file again, e.g. after it was edited, and checks that the given facts,
+	/// e.g. a monitor's geometry, ground and solve with it. Replaces the shared program on success,
+	/// for the monitors that get it from now on. Returns nullptr on failure. Safe to call from any thread.
+	static TSharedPtr<const FTrafficRules, ESPMode::ThreadSafe> Reload(const FString& RulesFileFullName, const std::string& ValidationFacts);
+
+	/// Full path of a rule file that lives in the plugin's LogicSolver directory.
+	static FString GetRulesFileFullName(const FString& RulesFileName);
+
+	~FTrafficRules();
+
+	/// Adds the parsed statements to the "base" program of the control object, without re-parsing the text.
+	void AddToControl(Clingo::Control& Control) const;
+
+	/// Grounds the rules with the given event and geometry facts, and returns the decisions of the answer.
+	/// False if there is none or the solver failed. Safe to call from any thread.
+	bool Solve(const std::string& Facts, FDecisionSet& OutDecisions, size_t* OutNumGroundAtoms = nullptr) const;
+
+	/// The same with other solver options than the rule file's, e.g. to compare them.
+	bool Solve(const FSolverConfig& Config, const std::string& Facts, FDecisionSet& OutDecisions, size_t* OutNumGroundAtoms = nullptr) const;
+
+	const FSolverConfig& GetSolverConfig() const { return SolverConfig; }
+
+	const FString& GetFileFullName() const { return FileFullName; }
+	const std::string& GetSource() const { return Source; }
+
+	/// Predicates whose atoms the monitor acts upon.
+	static const TArray<FString>& GetDecisionPredicates();
+
+	/// The same with their arities, e.g. "hasRightOfWay/1". The parsed program shows these only.
+	static const TArray<FString>& GetDecisionSignatures();
+
+	/// Whether atoms of a predicate can, directly or through derived predicates, change a decision atom.
+	bool MayAffectDecisions(const FString& Predicate) const { return DecisionInputs.Contains(Predicate); }
+
+	/// Whether the program is stratified and has no choice rules, disjunctions, externals
+	/// nor optimization statements, so that it has at most one answer set and the first model is the answer.
+	/// False whenever the parsed program has anything the analysis does not understand.
+	bool HasUniqueModel() const { return bHasUniqueModel; }
+
+	/// Whether every "mustYieldToForRule" rule needs "overlaps" or "isToTheRightOf" atoms, so that a waiting
+	/// vehicle never yields to a vehicle whose lanes do not conflict with its own at a fork that is not adjacent.
+	/// False for rules that yield by arrival order alone, like all-way-stop_new.cl.
+	bool YieldsOnlyOnConflicts() const { return bYieldsOnlyOnConflicts; }
+
+private:
+	FTrafficRules(const FString& InFileFullName, std::string&& InSource);
+	static FString GetCacheKey(const FString& RulesFileFullName);
+	static TSharedPtr<FTrafficRules, ESPMode::ThreadSafe> Load(const FString& Key);
+	bool Parse();
+	void AnalyzeDependencies(const TMap<FString, TSet<FString>>& Dependencies, const TMap<FString, TSet<FString>>& NegativeDependencies);
+
+	FString FileFullName;
+	std::string Source;
+	FSolverConfig SolverConfig;
+
+	TSet<FString> DecisionInputs; // Predicates the decision predicates depend on, including themselves
+	bool bHasUniqueModel = false;
+	bool bYieldsOnlyOnConflicts = false;
+
+	struct FParsedProgram;
+	TUniquePtr<FParsedProgram> ParsedProgram;
+};
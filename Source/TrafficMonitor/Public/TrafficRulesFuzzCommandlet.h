@@ -0,0 +1,25 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+// Generated
+#include "TrafficRulesFuzzCommandlet.generated.h"
+
+/// Fuzzes a traffic rule program on every core:
+///   UE4Editor-Cmd <Project> -run=TrafficRulesFuzz -Geometry=<Monitor>Geometry.cl
+///     [-Rules=all-way-stop_new.cl] [-Scenarios=10000] [-MaxVehicles=6] [-Seed=0] [-Reproducers=5]
+/// The geometry file is relative to the Saved directory, where the monitors write it at BeginPlay.
+/// Minimized failing event sets are written to Saved/RulesFuzzer/<failure>_<scenario>.cl.
+UCLASS()
+class TRAFFICMONITOR_API UTrafficRulesFuzzCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UTrafficRulesFuzzCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,27 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+// Generated
+#include "TrafficSolverTuneCommandlet.generated.h"
+
+/// Picks the fastest solver options of a rule program over recorded analytics traces:
+///   UE4Editor-Cmd <Project> -run=TrafficSolverTune [-Rules=all-way-stop_new.cl] [-Traces=Analytics/]
+///     [-Configurations=auto,frumpy,jumpy,tweety,handy,crafty,trendy] [-Heuristics=default,Berkmin,Vmtf,Vsids]
+///     [-Threads=1,2] [-MaxScenarios=1000] [-Repeats=3] [-Metric=p95] [-DryRun]
+/// Traces are .tmal files, or directories of them, relative to the Saved directory. Each is replayed with the
+/// Saved/<Monitor>Geometry.cl of the monitor that recorded it. The best options are written next to the rule file,
+/// as its "<rules file>.config" sidecar that monitors load with the rules.
+UCLASS()
+class TRAFFICMONITOR_API UTrafficSolverTuneCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UTrafficSolverTuneCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,26 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/SubclassOf.h"
+
+class AActor;
+class UPrimitiveComponent;
+
+namespace TriggerCollision
+{
+	/// Collision profile of the "TrafficMonitor" object channel, defined in the plugin's Config/DefaultEngine.ini.
+	TRAFFICMONITOR_API extern const FName ProfileName;
+
+	/// Makes a trigger volume overlap vehicles only, with the TrafficMonitor profile when the project has it.
+	/// Triggers do not overlap each other, use TriggersOverlap to relate them.
+	TRAFFICMONITOR_API void SetupTrigger(UPrimitiveComponent* Trigger);
+
+	/// Whether a trigger of one actor overlaps a trigger of the other.
+	/// Tests the shapes directly, so it does not depend on the triggers' collision responses.
+	TRAFFICMONITOR_API bool TriggersOverlap(const AActor* A, const AActor* B);
+
+	/// The actors of a class whose triggers overlap those of the actor, e.g. the forks and lanes of a monitor.
+	TRAFFICMONITOR_API void GetOverlappingTriggerActors(const AActor* Actor, TSubclassOf<AActor> Class, TArray<AActor*>& OutActors);
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Pawn.h"
+#include "Components/BoxComponent.h"
+
+// Developer
+#include "DistanceTimeCurve.h"
+
+// Generated
+#include "VehicleProxy.generated.h"
+
+class ALane;
+class ATrafficGenerator;
+
+/// Kinematic stand-in for a vehicle, for load testing the monitors.
+/// Drives straight to its lane's fork, along the lane's spline, and straight on past the exit,
+/// following the distance-time profile of its UDistanceTimeCurve.
+/// Stops at the fork until the monitor gives it the right of way, and behind the proxy ahead of it.
+UCLASS(NotPlaceable)
+class TRAFFICMONITOR_API AVehicleProxy : public APawn
+{
+	GENERATED_BODY()
+
+public:
+	AVehicleProxy(const FObjectInitializer &ObjectInitializer);
+
+	virtual void Tick(float DeltaTime) override;
+
+	void Init(ATrafficGenerator* InGenerator, ALane* InLane, AVehicleProxy* InLeader, float InApproachLength, float InDepartureLength, float Speed);
+
+	FString GetSignalString() const { return Signal; }
+
+	/// Called by the monitor with its decisions
+	void SetMayProceed(bool bInMayProceed);
+
+	float GetDistance() const { return Distance; }
+	float GetApproachLength() const { return ApproachLength; }
+
+public:
+	UPROPERTY(EditAnywhere)
+	UBoxComponent* Body;
+
+	UPROPERTY(VisibleAnywhere)
+	UDistanceTimeCurve* SpeedProfile;
+
+	float MinimumGap = 300.f; // Bumper to bumper distance kept in queues, in cm
+
+private:
+	FVector GetLocationAtDistance(float InDistance, FVector& OutDirection) const;
+
+	UPROPERTY()
+	ATrafficGenerator* Generator = nullptr;
+
+	UPROPERTY()
+	ALane* Lane = nullptr;
+
+	TWeakObjectPtr<AVehicleProxy> Leader; // The proxy spawned before this one on the same fork
+
+	FString Signal;
+	float ApproachLength = 0.f;
+	float LaneLength = 0.f;
+	float TotalLength = 0.f;
+
+	float ProfileTime = 0.f; // Stands still while the proxy is held back
+	float Distance = 0.f;
+	bool bMayProceed = false; // All-way stop: wait for the right of way
+
+	float SpawnTime = 0.f;
+	float ArrivalTime = -1.f;
+	float FirstDecisionTime = -1.f;
+	float ProceedTime = -1.f;
+};
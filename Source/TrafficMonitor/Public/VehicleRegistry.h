@@ -0,0 +1,58 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+
+// Generated
+#include "VehicleRegistry.generated.h"
+
+class ACarlaWheeledVehicle;
+class AVehicleProxy;
+class AWheeledVehicleAIController;
+
+/// A vehicle tracked by at least one monitor of the world
+struct FRegisteredVehicle
+{
+	TWeakObjectPtr<AActor> Actor;
+	FObjectKey Key; // Stays unique after the actor is destroyed, unlike its address
+	TWeakObjectPtr<ACarlaWheeledVehicle> CarlaVehicle;
+	TWeakObjectPtr<AVehicleProxy> Proxy;
+	TWeakObjectPtr<AWheeledVehicleAIController> Controller; // Of CARLA vehicles, looked up again when it changes
+	FString Name; // Of the actor, as the monitors key their vehicles
+	FString Atom; // "v_Name", as in the events and decisions
+	int32 NumMonitors = 0;
+};
+
+/// Dense ids for the vehicles the monitors of a world track, shared by all of them: a vehicle crossing several
+/// intersections is registered, named and has its controller looked up once. Vehicles are held weakly, so decisions
+/// for a vehicle destroyed in the meantime are dropped. An id is reused once no monitor tracks its vehicle anymore.
+UCLASS()
+class TRAFFICMONITOR_API UVehicleRegistry : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/// The id of Vehicle, registered if new, for one more monitor. Release it once per Acquire.
+	int32 Acquire(AActor* Vehicle);
+	void Release(int32 Id);
+
+	/// INDEX_NONE if no monitor tracks the vehicle.
+	int32 Find(const AActor* Vehicle) const;
+	int32 FindByAtom(const FString& Atom) const;
+
+	const FRegisteredVehicle& Get(int32 Id) const { return Vehicles[Id]; }
+	int32 Num() const { return Ids.Num(); }
+
+	/// False if the vehicle is gone or neither a CARLA vehicle nor a vehicle proxy.
+	bool GetSignal(int32 Id, FString& OutSignal) const;
+	bool SetMayProceed(int32 Id, bool bMayProceed);
+
+private:
+	TArray<FRegisteredVehicle> Vehicles; // By id
+	TArray<int32> FreeIds;
+	TMap<FObjectKey, int32> Ids;
+	TMap<FString, int32> IdsByAtom;
+};
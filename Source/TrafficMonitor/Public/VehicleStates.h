@@ -0,0 +1,60 @@
+// Copyright (c) 2017 Computer Vision Center (CVC) at the Universitat Autonoma de Barcelona (UAB). This work is licensed under the terms of the MIT license. For a copy, see <https://opensource.org/licenses/MIT>.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Developer
+#include "LaneConflicts.h"
+#include "MonitorEvent.h"
+
+// STL
+#include <string>
+
+enum class EVehiclePhase : uint8
+{
+	Approaching, // Not arrived yet, e.g. spawned inside the monitor
+	AtFork, // Arrived and waiting to enter
+	Entered,
+	OnLane,
+	Left, // Left every lane it entered
+};
+
+/// What the monitor knows about a vehicle, advanced by each of its events as they happen.
+struct FVehicleState
+{
+	EVehiclePhase Phase = EVehiclePhase::Approaching;
+	FString Fork; // Atom of the fork it arrived at
+	int32 ArrivalTimeStep = INDEX_NONE;
+	TBitArray<> WantedLanes; // Lanes of its fork matching its signal
+	TBitArray<> OnLanes;
+	TBitArray<> LeftLanes;
+};
+
+/// The per-vehicle state machines of a monitor. They derive natively what the event-based rule programs derive
+/// in the solver (atTheIntersection, isAtFork, wantsLane, isOnLane, leftLane, reservedLane), so that hybrid
+/// programs like all-way-stop_hybrid.cl only ground the rules themselves.
+class TRAFFICMONITOR_API FVehicleStates
+{
+public:
+	void Reset() { States.Empty(); }
+	void Remove(const FString& Vehicle) { States.Remove(Vehicle); }
+	const FVehicleState* Find(const FString& Vehicle) const { return States.Find(Vehicle); }
+
+	/// Advances the vehicle's state with one of its events. Signals are resolved to lanes
+	/// with the monitor's "f_Fork/signal" lane sets.
+	void Apply(const FString& Vehicle, const FMonitorEvent& Event, const FLaneConflictMatrix& Lanes,
+		const TMap<FString, TBitArray<>>& LanesByForkAndSignal);
+
+	/// The state facts of the given vehicles:
+	///   arrived(V), waitingAtFork(V, Fork, ArrivalTime), wantsLane(V, Lane) of waiting vehicles,
+	///   reservedLane(V, Lane) and, for vehicles with a reserved lane, leftLane(V, Lane).
+	/// Arrival times of the waiting vehicles are replaced by their dense ranks when normalized.
+	std::string GetFacts(const TArray<FString>& Vehicles, const FLaneConflictMatrix& Lanes, bool bNormalize, int32& OutNumTimeSteps) const;
+
+	/// The state predicates an event predicate changes, e.g. "waitingAtFork" for "entersForkAtTime"
+	static const TArray<FString>& GetStatePredicates(const FString& EventPredicate);
+
+private:
+	TMap<FString, FVehicleState> States; // By actor name
+};